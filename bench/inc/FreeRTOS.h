@@ -0,0 +1,21 @@
+#ifndef FREERTOS_H
+#define FREERTOS_H
+
+#include <stdint.h>
+
+/**
+ * Stand-in for the FreeRTOS kernel headers in the host benchmark build, with just what the
+ * modules under test use. The benchmarks run on a single thread, without a scheduler.
+ */
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stddef.h>
+
+/**
+ * Microbenchmarks of the board-independent code that runs on every command line and loop
+ * tick: tokenizer, command and name lookups, hex parsing and printing.
+ */
+
+/** A benchmark case. */
+typedef struct {
+    /** Case name, used as the key of the results. */
+    const char *name;
+    /** Prepare the input, once before timing. May be NULL. */
+    void (*setup)();
+    /**
+     * Run one operation.
+     *
+     * \return the amount of bytes processed (input, or output for formatting functions).
+     */
+    size_t (*run)();
+} bench_case_t;
+
+/** All the benchmark cases. */
+extern const bench_case_t bench_cases[];
+
+/** Amount of elements in `bench_cases`. */
+extern const size_t bench_cases_count;
+
+/** Amount of bytes written to the terminal by the code under test (see stubs.c). */
+extern size_t bench_output_bytes;
+
+#endif
@@ -0,0 +1,272 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#ifdef BENCH_TARGET
+
+#include "sapi.h"
+
+/** Unit of the measurements: the DWT cycle counter. */
+#define BENCH_UNIT "cycles"
+/** Minimum duration of each measurement (about 10 ms at 204 MHz) */
+#define BENCH_MIN_TIME 2000000
+
+typedef uint32_t bench_time_t;
+
+static bench_time_t now() {
+    return cyclesCounterRead();
+}
+
+#else
+
+#include <time.h>
+#include <unistd.h>
+
+/** Unit of the measurements: the host monotonic clock. */
+#define BENCH_UNIT "ns"
+/** Minimum duration of each measurement (20 ms) */
+#define BENCH_MIN_TIME 20000000
+
+typedef uint64_t bench_time_t;
+
+static bench_time_t now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (bench_time_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
+
+/** Amount of measurements of each case, after calibration; the fastest one is reported */
+#define BENCH_REPEAT 5
+/** Default slowdown (percent) reported as a regression when comparing with a baseline */
+#define BENCH_THRESHOLD_DEFAULT 10
+/** Maximum length of a results line */
+#define BENCH_LINE_MAX 96
+
+/** Header of the results, in CSV format. */
+#define BENCH_HEADER "case,iterations," BENCH_UNIT "_per_op,bytes_per_op"
+
+/** Result of a benchmark case. */
+typedef struct {
+    /** Amount of operations of each measurement. */
+    unsigned long iterations;
+    /** Time per operation, in hundredths of BENCH_UNIT. */
+    unsigned long time_x100;
+    /** Bytes per operation, in hundredths. */
+    unsigned long bytes_x100;
+} bench_result_t;
+
+/** Accumulates the values returned by the cases, so that they are not optimized out. */
+static volatile size_t bench_sink;
+
+/** Run n operations of a case. \return the elapsed time. */
+static bench_time_t run_batch(const bench_case_t *c, unsigned long n, size_t *bytes) {
+    size_t total = 0;
+    bench_time_t start = now();
+    for (unsigned long i = 0; i < n; i++) {
+        total += c->run();
+    }
+    bench_time_t elapsed = now() - start;
+    bench_sink += total;
+    *bytes = total;
+    return elapsed;
+}
+
+/**
+ * Measure a case: double the amount of operations until a batch takes BENCH_MIN_TIME,
+ * and then keep the fastest of BENCH_REPEAT batches of that size.
+ */
+static bench_result_t measure(const bench_case_t *c) {
+    if (c->setup) {
+        c->setup();
+    }
+    unsigned long n = 1;
+    size_t bytes;
+    bench_time_t best = run_batch(c, n, &bytes);
+    while (best < BENCH_MIN_TIME) {
+        n *= 2;
+        best = run_batch(c, n, &bytes);
+    }
+    for (int i = 1; i < BENCH_REPEAT; i++) {
+        bench_time_t elapsed = run_batch(c, n, &bytes);
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return (bench_result_t) {
+        .iterations = n,
+        .time_x100 = (unsigned long)(best * 100ULL / n),
+        .bytes_x100 = (unsigned long)(bytes * 100ULL / n),
+    };
+}
+
+/** Format a result as a CSV line, without the line terminator. */
+static void format_result(char *s, const char *name, const bench_result_t *r) {
+    snprintf(s, BENCH_LINE_MAX, "%s,%lu,%lu.%02lu,%lu.%02lu", name, r->iterations,
+        r->time_x100 / 100, r->time_x100 % 100, r->bytes_x100 / 100, r->bytes_x100 % 100);
+}
+
+#ifdef BENCH_TARGET
+
+/**
+ * Target entry point: run all the cases before starting the scheduler, and print the
+ * results in CSV format through the USB UART.
+ */
+int main() {
+    boardInit();
+    cyclesCounterInit(SystemCoreClock);
+    uartConfig(UART_USB, 115200);
+
+    uartWriteString(UART_USB, BENCH_HEADER "\r\n");
+    char s[BENCH_LINE_MAX];
+    for (size_t i = 0; i < bench_cases_count; i++) {
+        bench_result_t r = measure(&bench_cases[i]);
+        format_result(s, bench_cases[i].name, &r);
+        uartWriteString(UART_USB, s);
+        uartWriteString(UART_USB, "\r\n");
+    }
+    while (1) {
+    }
+}
+
+#else
+
+/** Print the usage help. */
+static void usage(const char *program) {
+    fprintf(stderr,
+        "Usage: %s [-o <results.csv>] [-b <baseline.csv> [-t <percent>]] [<case>...]\n"
+        "\n"
+        "Run the benchmark cases (all of them, or the given ones) and print the time and\n"
+        "bytes processed per operation.\n"
+        "\n"
+        "  -o  Also write the results to a file, in CSV format.\n"
+        "  -b  Compare with the results of a previous run, and exit with status 1 if any\n"
+        "      case is slower by more than <percent> (default %d).\n",
+        program, BENCH_THRESHOLD_DEFAULT);
+}
+
+/** Return true if the case was selected in the command line (or none was). */
+static bool selected(const char *name, int argc, char *argv[]) {
+    if (argc == 0) {
+        return true;
+    }
+    for (int i = 0; i < argc; i++) {
+        if (!strcmp(argv[i], name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Find the time per operation of a case in a results file.
+ *
+ * \return false if the case is not in the file.
+ */
+static bool baseline_time(FILE *f, const char *name, double *out) {
+    char line[BENCH_LINE_MAX];
+    rewind(f);
+    while (fgets(line, sizeof(line), f)) {
+        char *comma = strchr(line, ',');
+        if (comma == NULL || (size_t)(comma - line) != strlen(name) || strncmp(line, name, comma - line)) {
+            continue;
+        }
+        char *time = strchr(comma + 1, ',');
+        if (time == NULL) {
+            return false;
+        }
+        *out = strtod(time + 1, NULL);
+        return true;
+    }
+    return false;
+}
+
+int main(int argc, char *argv[]) {
+    const char *output = NULL;
+    const char *baseline = NULL;
+    int threshold = BENCH_THRESHOLD_DEFAULT;
+    int opt;
+    while ((opt = getopt(argc, argv, "o:b:t:h")) != -1) {
+        switch (opt) {
+        case 'o':
+            output = optarg;
+            break;
+        case 'b':
+            baseline = optarg;
+            break;
+        case 't':
+            threshold = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    FILE *out = NULL;
+    if (output && (out = fopen(output, "w")) == NULL) {
+        perror(output);
+        return 2;
+    }
+    FILE *base = NULL;
+    if (baseline && (base = fopen(baseline, "r")) == NULL) {
+        perror(baseline);
+        return 2;
+    }
+    if (base) {
+        char header[BENCH_LINE_MAX];
+        if (!fgets(header, sizeof(header), base) || strncmp(header, BENCH_HEADER, strlen(BENCH_HEADER))) {
+            fprintf(stderr, "%s: not a results file in " BENCH_UNIT "\n", baseline);
+            return 2;
+        }
+    }
+
+    if (out) {
+        fprintf(out, BENCH_HEADER "\n");
+    }
+    printf("%-20s %10s %14s %12s\n", "case", "iterations", BENCH_UNIT "/op", "bytes/op");
+
+    int regressions = 0;
+    char s[BENCH_LINE_MAX];
+    for (size_t i = 0; i < bench_cases_count; i++) {
+        const bench_case_t *c = &bench_cases[i];
+        if (!selected(c->name, argc - optind, argv + optind)) {
+            continue;
+        }
+        bench_result_t r = measure(c);
+        if (out) {
+            format_result(s, c->name, &r);
+            fprintf(out, "%s\n", s);
+        }
+        printf("%-20s %10lu %11lu.%02lu %9lu.%02lu", c->name, r.iterations,
+            r.time_x100 / 100, r.time_x100 % 100, r.bytes_x100 / 100, r.bytes_x100 % 100);
+
+        double before;
+        if (base && baseline_time(base, c->name, &before) && before > 0) {
+            double change = (r.time_x100 / 100.0 - before) * 100 / before;
+            bool regression = change > threshold;
+            printf("  %+6.1f%%%s", change, regression ? "  REGRESSION" : "");
+            regressions += regression;
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+
+    if (out) {
+        fclose(out);
+    }
+    if (base) {
+        fclose(base);
+    }
+    if (regressions) {
+        fprintf(stderr, "%d case(s) slower than the baseline by more than %d%%\n", regressions, threshold);
+        return 1;
+    }
+    return 0;
+}
+
+#endif
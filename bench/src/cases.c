@@ -0,0 +1,182 @@
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "cli.h"
+#include "commands.h"
+#include "gpio.h"
+#include "hex.h"
+#include "lookup.h"
+#include "lzss.h"
+#include "tokenizer.h"
+
+/** Amount of bytes of the hex payloads (the largest `i2c` and `spi` transfers are similar) */
+#define HEX_PAYLOAD_NBYTES 256
+/** Amount of bytes compressed at a time (the output of a `buf dump` is up to 2048) */
+#define BULK_NBYTES 1024
+
+/** Command lines typical of an interactive session and of loop and watch tasks. */
+static const char *const corpus[] = {
+    "gpio LED1 write on",
+    "gpio TEC1 read",
+    "gpio LEDB toggle",
+    "loop start 10 gpio LED2 toggle",
+    "watch 10 heartbeat 5000 gpio TEC1 read",
+    "i2c slave 50 tx 00:00 stop rx 4 stop",
+    "spi xfer 9f:00:00:00",
+    "irq 0 TEC1 falling echo pressed",
+    "adc capture 1 100000 2048 stats",
+    "echo hello world > buf0",
+    "sleep 5000 &",
+    "help",
+};
+
+/** Return *i and advance it, cycling through an array of n elements. */
+static size_t cycle(size_t *i, size_t n) {
+    size_t current = *i;
+    *i = (current + 1) % n;
+    return current;
+}
+
+/** Feed a line and its newline to the tokenizer. \return the amount of bytes fed. */
+static size_t tokenize(const char *line, cmd_args_t *args) {
+    tokenizer_t tokenizer;
+    tokenizer_init(&tokenizer, args);
+    size_t n = 0;
+    while (line[n]) {
+        tokenizer_feed(&tokenizer, line[n++]);
+    }
+    tokenizer_feed(&tokenizer, '\n');
+    return n + 1;
+}
+
+static cmd_args_t args;
+static cmd_args_t subcmd;
+
+static size_t tokenize_run() {
+    static size_t i;
+    return tokenize(corpus[cycle(&i, ARRAY_SIZE(corpus))], &args);
+}
+
+static void extract_subcommand_setup() {
+    tokenize("loop start 10 gpio LED2 toggle", &args);
+}
+
+static size_t extract_subcommand_run() {
+    cli_extract_subcommand(&args, 3, &subcmd);
+    return sizeof(subcmd.buf);
+}
+
+/** Command names in the order they are looked up, including a miss. */
+static const char *const command_names[] = {
+    "gpio", "loop", "watch", "i2c", "spi", "irq", "adc", "echo", "sleep", "help", "nosuch",
+};
+
+static size_t find_command_run() {
+    static size_t i;
+    const char *name = command_names[cycle(&i, ARRAY_SIZE(command_names))];
+    return find_command(name) ? strlen(name) : 0;
+}
+
+/** `gpio` commands exercising the port, subcommand and on/off value lookups. */
+static const char *const gpio_lines[] = {
+    "gpio LED1 write on",
+    "gpio LEDB w 0",
+    "gpio LED3 write high",
+    "gpio TEC1 read",
+};
+
+static cmd_args_t gpio_args[ARRAY_SIZE(gpio_lines)];
+
+static void gpio_setup() {
+    for (size_t i = 0; i < ARRAY_SIZE(gpio_lines); i++) {
+        tokenize(gpio_lines[i], &gpio_args[i]);
+    }
+}
+
+static size_t gpio_run() {
+    static size_t next;
+    size_t i = cycle(&next, ARRAY_SIZE(gpio_lines));
+    gpio_command.handler(&gpio_args[i]);
+    return strlen(gpio_lines[i]);
+}
+
+/** `aa:bb:...` representation of a payload of HEX_PAYLOAD_NBYTES bytes. */
+static char hex_payload[HEX_PAYLOAD_NBYTES * 3];
+static uint8_t payload[HEX_PAYLOAD_NBYTES];
+
+static void hex_setup() {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < HEX_PAYLOAD_NBYTES; i++) {
+        payload[i] = i * 37 + 11;
+        hex_payload[3 * i] = digits[payload[i] >> 4];
+        hex_payload[3 * i + 1] = digits[payload[i] & 0xf];
+        hex_payload[3 * i + 2] = ':';
+    }
+    hex_payload[sizeof(hex_payload) - 1] = '\0';
+}
+
+static size_t hex_nbytes_run() {
+    size_t nbytes;
+    return hex_data_nbytes(hex_payload, &nbytes) ? sizeof(hex_payload) - 1 : 0;
+}
+
+static size_t hex_parse_run() {
+    size_t nbytes;
+    if (!hex_data_nbytes(hex_payload, &nbytes) || !hex_parse_data(hex_payload, nbytes, payload)) {
+        return 0;
+    }
+    return sizeof(hex_payload) - 1;
+}
+
+static size_t hex_parser_feed_run() {
+    hex_parser_t parser = {.out = payload, .max = sizeof(payload), .high_nibble = -1};
+    return hex_parser_feed(&parser, hex_payload) ? sizeof(hex_payload) - 1 : 0;
+}
+
+static size_t hex_print_run() {
+    size_t before = bench_output_bytes;
+    hex_print(payload, sizeof(payload));
+    return bench_output_bytes - before;
+}
+
+/** Output of a slowly changing `adc capture` in text format, for `bulk`. */
+static char bulk_input[BULK_NBYTES];
+static lzss_encoder_t encoder;
+static size_t compressed_nbytes;
+
+static void lzss_setup() {
+    size_t n = 0;
+    for (unsigned i = 0; n < sizeof(bulk_input); i++) {
+        unsigned sample = 512 + (i % 64 < 32 ? i % 64 : 64 - i % 64);
+        char s[8];
+        size_t len = snprintf(s, sizeof(s), i % 16 == 15 ? "%u\r\n" : "%u ", sample);
+        for (size_t j = 0; j < len && n < sizeof(bulk_input); j++) {
+            bulk_input[n++] = s[j];
+        }
+    }
+}
+
+static void count_compressed(void *context, const uint8_t data[], size_t nbytes) {
+    compressed_nbytes += nbytes;
+}
+
+static size_t lzss_run() {
+    lzss_init(&encoder, count_compressed, NULL);
+    lzss_feed(&encoder, bulk_input, sizeof(bulk_input));
+    lzss_finish(&encoder);
+    return sizeof(bulk_input);
+}
+
+const bench_case_t bench_cases[] = {
+    {"tokenize", NULL, tokenize_run},
+    {"extract_subcommand", extract_subcommand_setup, extract_subcommand_run},
+    {"find_command", NULL, find_command_run},
+    {"gpio_command", gpio_setup, gpio_run},
+    {"hex_data_nbytes", hex_setup, hex_nbytes_run},
+    {"hex_parse_data", hex_setup, hex_parse_run},
+    {"hex_parser_feed", hex_setup, hex_parser_feed_run},
+    {"hex_print", hex_setup, hex_print_run},
+    {"lzss_compress", lzss_setup, lzss_run},
+};
+
+const size_t bench_cases_count = ARRAY_SIZE(bench_cases);
@@ -0,0 +1,113 @@
+#include <string.h>
+#include "bench.h"
+#include "cli.h"
+#include "terminal.h"
+#include "sapi.h"
+#include "semphr.h"
+#include "echo.h"
+#include "sleep.h"
+#include "loop.h"
+#include "watch.h"
+#include "jobs.h"
+#include "irq.h"
+#include "i2c.h"
+#include "spi.h"
+#include "adc.h"
+#include "pool.h"
+#include "buf.h"
+#include "bulk.h"
+#include "log.h"
+
+/*
+ * Replacements for the parts of the firmware that the modules under test call but that
+ * are not measured: the terminal (output is only counted), the commands not linked into
+ * the benchmark and, on the host, the RTOS and the board.
+ */
+
+size_t bench_output_bytes;
+
+void terminal_putc(const char c) {
+    bench_output_bytes++;
+}
+
+void terminal_puts(const char s[]) {
+    bench_output_bytes += strlen(s);
+}
+
+void terminal_println(const char s[]) {
+    bench_output_bytes += strlen(s) + 2;
+}
+
+void terminal_write(const void *data, size_t nbytes) {
+    bench_output_bytes += nbytes;
+}
+
+char terminal_getc() {
+    return '\n';
+}
+
+void terminal_gets(char buf[], size_t bufsize) {
+    buf[0] = '\0';
+}
+
+size_t terminal_read(void *data, size_t nbytes, unsigned timeout_ms) {
+    return 0;
+}
+
+bool cli_is_interactive() {
+    return true;
+}
+
+/** A command that is listed in `commands` but not linked into the benchmark. */
+#define STUB_COMMAND(cmd) const cmd_t cmd##_command = {.name = #cmd}
+
+STUB_COMMAND(adc);
+STUB_COMMAND(buf);
+STUB_COMMAND(bulk);
+STUB_COMMAND(echo);
+STUB_COMMAND(help);
+STUB_COMMAND(i2c);
+STUB_COMMAND(irq);
+STUB_COMMAND(jobs);
+STUB_COMMAND(kill);
+STUB_COMMAND(log);
+STUB_COMMAND(loop);
+STUB_COMMAND(pool);
+STUB_COMMAND(sleep);
+STUB_COMMAND(spi);
+STUB_COMMAND(terminal);
+STUB_COMMAND(wait);
+STUB_COMMAND(watch);
+
+#ifndef BENCH_TARGET
+
+static bool_t pins[SIM_PIN_COUNT];
+
+bool_t gpioRead(gpioMap_t pin) {
+    return pins[pin];
+}
+
+bool_t gpioWrite(gpioMap_t pin, bool_t value) {
+    pins[pin] = value;
+    return TRUE;
+}
+
+bool_t gpioToggle(gpioMap_t pin) {
+    pins[pin] = !pins[pin];
+    return TRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    static int mutex;
+    return &mutex;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t mutex, TickType_t timeout) {
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t mutex) {
+    return pdTRUE;
+}
+
+#endif
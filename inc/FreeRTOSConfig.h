@@ -60,7 +60,10 @@ extern int DbgConsole_Printf( const char *fmt_s, ... );
 #define configTICK_RATE_HZ                           ( ( TickType_t ) 1000 ) // 1000 ticks per second => 1ms tick rate
 #define configMAX_PRIORITIES                         ( 7 )
 #define configMINIMAL_STACK_SIZE                     ( ( uint16_t ) 90 )
-#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 8 * 1024 ) )    /* 85 Kbytes. */
+/* At boot: ~6.6 KB (terminal queues, cli, job workers, buf mutexes, idle and timer
+ * tasks). On demand: ~1.6 KB for irq, ~0.5 KB per loop, ~0.8 KB per watch, plus the
+ * gpio/i2c/spi mutexes; ~12.7 KB with everything running. See `pool`. */
+#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 16 * 1024 ) )
 #define configMAX_TASK_NAME_LEN                      ( 16 )
 #define configUSE_TRACE_FACILITY                     1
 #define configUSE_16_BIT_TICKS                       0
@@ -75,6 +78,7 @@ extern int DbgConsole_Printf( const char *fmt_s, ... );
 #define configGENERATE_RUN_TIME_STATS                0
 #define configOVERRIDE_DEFAULT_TICK_CONFIGURATION    1
 #define configRECORD_STACK_HIGH_ADDRESS              1
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS      2    /* see terminal.c */
 
 /* Co-routine definitions. */
 #define configUSE_CO_ROUTINES                        0
@@ -0,0 +1,9 @@
+#ifndef ADC_H
+#define ADC_H
+
+#include "cli.h"
+
+/** `adc` command definition. */
+extern const cmd_t adc_command;
+
+#endif
@@ -0,0 +1,25 @@
+#ifndef BUF_H
+#define BUF_H
+
+#include "cli.h"
+#include "terminal.h"
+
+/**
+ * Named RAM ring buffers (`buf0`, `buf1`, ...) that can receive the output of commands,
+ * eg: `loop start 5 gpio TEC1 read > buf0`.
+ */
+
+/** Initialize the buffers. */
+bool buf_init();
+
+/**
+ * Find a buffer by name.
+ *
+ * \return the output sink that writes to the buffer, or NULL if not found.
+ */
+terminal_sink_t *buf_find_sink(const char *name);
+
+/** `buf` command definition. */
+extern const cmd_t buf_command;
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef BULK_H
+#define BULK_H
+
+#include "cli.h"
+
+/**
+ * Compressed bulk transfers: `bulk <command...>` executes a command (typically a dump,
+ * eg: `buf dump`, `adc capture ... bin`, `i2c stream dump`) compressing its output with
+ * LZSS (see `lzss.h`) into binary frames, decoded on the host by `tools/bulkdecode.py`.
+ */
+
+/** `bulk` command definition. */
+extern const cmd_t bulk_command;
+
+#endif
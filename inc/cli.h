@@ -3,6 +3,8 @@
 
 #include <stdbool.h>
 
+struct terminal_sink;
+
 /** Maximum length of a command line. */
 #define CLI_LINE_MAX 80
 
@@ -44,12 +46,48 @@ bool cli_init();
 /** `help` command definition. */
 extern const cmd_t help_command;
 
-/** Extract a subcommand starting from a given argument index. */
+/**
+ * Extract a subcommand starting from a given argument index. Implemented in `tokenizer.c`,
+ * which does not depend on the RTOS.
+ */
 void cli_extract_subcommand(const cmd_args_t *cmd, unsigned subcmd_arg_index, cmd_args_t *subcmd);
 
-/** Execute the command. */
+/**
+ * Take a command line buffer from the shared pool, for tasks that parse or store
+ * commands. Safe to call from an ISR.
+ *
+ * \return the buffer, or NULL if all of them are in use.
+ */
+cmd_args_t *cli_args_alloc();
+
+/** Return a buffer obtained with `cli_args_alloc`. */
+void cli_args_free(cmd_args_t *args);
+
+/**
+ * Return true if the calling task is the CLI task, ie: the command was typed at the
+ * prompt. Only then can the command read more input from the terminal; in any other task
+ * (eg: `loop`, `watch`, `irq`, `&`) it would steal the input of the CLI.
+ */
+bool cli_is_interactive();
+
+/**
+ * Execute the command. If the command ends with `> <name>`, its output is redirected to
+ * the named output buffer (see `buf.h`). If it ends with `&`, it is queued to run in the
+ * background (see `jobs.h`).
+ */
 void cli_exec_command(const cmd_args_t *args);
 
+/**
+ * For commands that start tasks (eg: `loop start`): return the output sink for the task,
+ * and send the output of the command itself (eg: the handle, errors) where it would have
+ * gone without the redirection, which applies only to the task. Eg: after
+ * `loop start 100 gpio TEC1 read > buf0`, the loop handle is printed, and the task
+ * writes to buf0.
+ *
+ * \return the current output sink (see terminal_get_sink), if not redirected.
+ */
+struct terminal_sink *cli_take_redirection();
+
 /**
  * Utility macro: check a condition; if it's false, print an error message,
  * execute the given commands and return.
@@ -4,9 +4,13 @@
 #include "cli.h"
 
 /**
- * List of supported commands.
+ * List of supported commands, sorted by name in `strcmp` order. New commands must be
+ * inserted in order.
  */
-extern const cmd_t *commands[];
+extern const cmd_t *const commands[];
+
+/** Amount of elements in `commands`. */
+extern const size_t commands_count;
 
 /**
  * Find a command by its name.
@@ -15,5 +19,8 @@ extern const cmd_t *commands[];
  */
 const cmd_t *find_command(const char *name);
 
+/** Return true if `commands` is correctly sorted. */
+bool commands_sorted();
+
 #endif
 
@@ -0,0 +1,58 @@
+#ifndef DMA_H
+#define DMA_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+/**
+ * GPDMA channel allocation and interrupt dispatching.
+ *
+ * The GPDMA controller has a single interrupt for all of its channels. This module owns
+ * `DMA_IRQHandler` and forwards the completion of each channel to the callback of the
+ * module that opened it (eg: `spi_engine`).
+ */
+
+/**
+ * Channel completion callback. Called from the DMA ISR.
+ *
+ * \param channel The channel that finished.
+ * \param ok False if the transfer ended because of an error.
+ * \param context The context given to dma_channel_open.
+ * \param woken Set to pdTRUE if a higher priority task was woken.
+ */
+typedef void (*dma_callback_t)(uint8_t channel, bool ok, void *context, BaseType_t *woken);
+
+/**
+ * Reserve a DMA channel.
+ *
+ * \param callback Function called from the ISR each time a transfer on the channel ends.
+ * \param context Passed to the callback.
+ *
+ * \return the channel number, or -1 if all channels are in use.
+ */
+int dma_channel_open(dma_callback_t callback, void *context);
+
+/** Stop any transfer in progress and release the channel. */
+void dma_channel_close(int channel);
+
+/**
+ * Start a transfer on a channel obtained with dma_channel_open.
+ *
+ * \param channel The channel.
+ * \param src Source address, or a GPDMA_CONN_* peripheral connection.
+ * \param dst Destination address, or a GPDMA_CONN_* peripheral connection.
+ * \param type One of GPDMA_TRANSFERTYPE_*.
+ * \param count Amount of items to transfer, up to DMA_TRANSFER_MAX.
+ *
+ * \return false if the transfer cannot be started.
+ */
+bool dma_start(int channel, uint32_t src, uint32_t dst, uint32_t type, uint32_t count);
+
+/** Stop the transfer in progress on a channel, if any. */
+void dma_stop(int channel);
+
+/** Maximum amount of items in a single transfer (the width of the GPDMA transfer size field). */
+#define DMA_TRANSFER_MAX 4095
+
+#endif
@@ -2,8 +2,19 @@
 #define GPIO_H
 
 #include "cli.h"
+#include "sapi.h"
 
 /** `gpio` command definition. */
 extern const cmd_t gpio_command;
 
+/**
+ * Find a GPIO pin given its name (eg: `"LED1"`).
+ *
+ * \return false if the name does not correspond to a supported port.
+ */
+bool gpio_find_pin(const char *name, gpioMap_t *out);
+
+/** Return true if the name tables of the `gpio` command are correctly sorted. */
+bool gpio_tables_sorted();
+
 #endif
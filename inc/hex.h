@@ -0,0 +1,83 @@
+#ifndef HEX_H
+#define HEX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum time to wait for each byte of binary input (ms) */
+#define HEX_BIN_TIMEOUT_MS 1000
+
+/**
+ * Given a sequence of bytes expressed in hex format, this function returns the amount of
+ * bytes needed to parse it.
+ *
+ * Eg: `hex_data_nbytes("aa:bb:cc:dd:ee", &out)` sets `*out = 5`.
+ *
+ * \param data_hex The input string.
+ * \param out Output variable that will store the detected amount of bytes.
+ *
+ * \return false if the data cannot be parsed successfully.
+ */
+bool hex_data_nbytes(const char *data_hex, size_t *out);
+
+/**
+ * Parse a sequence of bytes expressed in hex format.
+ *
+ * \param data_hex The input string.
+ * \param nbytes The amount of bytes expressed in data_hex. It should have been previously
+ *               computed with hex_data_nbytes.
+ * \param out A buffer containing space for nbytes bytes.
+ *
+ * Eg: `hex_parse_data("aa:bb:cc:dd:ee", 5, out)` sets `out = {0xaa, 0xbb, 0xcc, 0xdd, 0xee}`.
+ *
+ * \return false if the data cannot be parsed successfully.
+ */
+bool hex_parse_data(const char *data_hex, size_t nbytes, uint8_t out[]);
+
+/** Incremental parser for hex data that arrives in chunks. */
+typedef struct {
+    /** Output buffer. */
+    uint8_t *out;
+    /** Capacity of the output buffer. */
+    size_t max;
+    /** Amount of bytes parsed so far. */
+    size_t nbytes;
+    /** Value of the first digit of a byte whose second digit has not arrived yet, or -1. */
+    int high_nibble;
+} hex_parser_t;
+
+/**
+ * Feed a chunk of hex data to the parser. Bytes are pairs of hex digits, optionally
+ * separated by `:` or blanks. A byte may be split between two chunks.
+ *
+ * \return false if the data is invalid or does not fit in the output buffer.
+ */
+bool hex_parser_feed(hex_parser_t *parser, const char *s);
+
+/**
+ * Read hex data from the terminal, line by line, until an empty line. Each line is parsed
+ * as soon as it arrives. After an error, the input is still consumed until the empty line,
+ * so that the rest of the data is not executed as commands.
+ *
+ * \return false if the data cannot be parsed successfully.
+ */
+bool hex_read_lines(size_t *nbytes, uint8_t out[], size_t max);
+
+/**
+ * Obtain a data buffer described by a command line token:
+ *
+ * - `aa:bb:cc`: the bytes are given in the token itself.
+ * - `-`: the bytes are read in hex format from the following lines (see hex_read_lines).
+ * - `@<n>`: n bytes are read in binary format right after the command line.
+ *
+ * The last two are only allowed in the CLI task (see cli_is_interactive).
+ *
+ * \return false if the data cannot be obtained or does not fit in max bytes.
+ */
+bool hex_read_data(const char *token, size_t *nbytes, uint8_t out[], size_t max);
+
+/** Print a sequence of bytes in hexadecimal format, followed by a newline. */
+void hex_print(const uint8_t data[], size_t nbytes);
+
+#endif
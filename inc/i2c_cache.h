@@ -0,0 +1,76 @@
+#ifndef I2C_CACHE_H
+#define I2C_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Write-through cache of I2C device registers, keyed by (device address, register).
+ *
+ * Nothing is cached by default: devices and individual registers must be marked as
+ * cacheable first. Registers that change on their own (status, data) should be left
+ * volatile. The cache assumes that devices auto-increment the register pointer on
+ * multi-byte accesses.
+ *
+ * The cache is not synchronized: callers must hold the i2c bus mutex.
+ */
+
+/** Cache statistics. */
+typedef struct {
+    /** Reads served from the cache. */
+    uint32_t read_hits;
+    /** Cacheable reads that had to use the bus. */
+    uint32_t read_misses;
+    /** Writes skipped because the registers already had the written values. */
+    uint32_t write_hits;
+    /** Cacheable writes that had to use the bus. */
+    uint32_t write_misses;
+    /** Values that could not be stored because the cache is full. */
+    uint32_t full;
+} i2c_cache_stats_t;
+
+/**
+ * Mark a device or a single register as cacheable or volatile.
+ *
+ * \param address 7-bit device address.
+ * \param reg Register address, or -1 to set the default for all registers of the device.
+ * \param cacheable The new policy.
+ *
+ * \return false if there is no room left to store the policy.
+ */
+bool i2c_cache_set_policy(uint8_t address, int reg, bool cacheable);
+
+/**
+ * Try to serve a read of nbytes consecutive registers from the cache.
+ *
+ * \return true on a hit, in which case data is filled with the cached values.
+ */
+bool i2c_cache_read(uint8_t address, uint8_t reg, uint8_t data[], size_t nbytes);
+
+/**
+ * Check whether a write of nbytes consecutive registers can be skipped.
+ *
+ * \return true if all registers are cacheable and already hold the given values.
+ */
+bool i2c_cache_write(uint8_t address, uint8_t reg, const uint8_t data[], size_t nbytes);
+
+/** Store the values read from or written to nbytes consecutive registers. */
+void i2c_cache_store(uint8_t address, uint8_t reg, const uint8_t data[], size_t nbytes);
+
+/**
+ * Forget the values of nbytes consecutive registers, eg: after a write that the device
+ * may have accepted only in part.
+ */
+void i2c_cache_invalidate_range(uint8_t address, uint8_t reg, size_t nbytes);
+
+/** Forget all cached values (policies are kept). */
+void i2c_cache_invalidate();
+
+/** Forget all cached values and policies, and reset the statistics. */
+void i2c_cache_reset();
+
+/** Get the cache statistics. */
+const i2c_cache_stats_t *i2c_cache_stats();
+
+#endif
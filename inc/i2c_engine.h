@@ -0,0 +1,114 @@
+#ifndef I2C_ENGINE_H
+#define I2C_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Status of an I2C transaction. */
+typedef enum {
+    /** The transaction is in progress. */
+    I2C_XFER_BUSY,
+    /** The transaction completed successfully. */
+    I2C_XFER_DONE,
+    /** The device did not acknowledge its address or a data byte. */
+    I2C_XFER_NACK,
+    /** Arbitration lost or unexpected bus state. */
+    I2C_XFER_ERROR,
+    /** The transaction did not complete in time and was aborted. */
+    I2C_XFER_TIMEOUT,
+} i2c_xfer_status_t;
+
+struct i2c_xfer;
+
+/**
+ * Transaction completion callback, called from the I2C ISR.
+ *
+ * \param xfer The completed transaction.
+ * \param woken Set to pdTRUE if a higher priority task was woken.
+ */
+typedef void (*i2c_xfer_callback_t)(struct i2c_xfer *xfer, BaseType_t *woken);
+
+/**
+ * I2C transaction descriptor.
+ *
+ * A transaction consists of an optional write phase followed by an optional read phase,
+ * each one ending with a stop condition or not. When the write phase does not end with
+ * a stop condition, the read phase starts with a repeated start. When the transaction
+ * does not end with a stop condition, the bus is held and the next transaction starts
+ * with a repeated start.
+ *
+ * A transaction with no data at all only sends the address (write), which is useful to
+ * probe for a device.
+ */
+typedef struct i2c_xfer {
+    /** 7-bit device address. */
+    uint8_t address;
+
+    /** Data to transmit. */
+    const uint8_t *tx_data;
+    /** Amount of bytes to transmit. */
+    size_t tx_nbytes;
+    /** Send a stop condition after the write phase. */
+    bool tx_stop;
+
+    /** Buffer for the received data. */
+    uint8_t *rx_data;
+    /** Amount of bytes to receive. */
+    size_t rx_nbytes;
+    /** Send a stop condition after the read phase. */
+    bool rx_stop;
+
+    /** Transaction status, updated by the ISR. */
+    volatile i2c_xfer_status_t status;
+
+    /** Completion callback, or NULL to notify the task that started the transaction. */
+    i2c_xfer_callback_t on_done;
+    /** Arbitrary data for the completion callback. */
+    void *context;
+
+    /** Internal: amount of bytes transmitted so far. */
+    size_t tx_index;
+    /** Internal: amount of bytes received so far. */
+    size_t rx_index;
+    /** Internal: true once the write phase is complete. */
+    bool reading;
+    /** Internal: task to notify on completion. */
+    TaskHandle_t task;
+} i2c_xfer_t;
+
+/** Configure the I2C0 peripheral for interrupt driven operation. */
+bool i2c_engine_init(uint32_t freq_hz);
+
+/**
+ * Start a transaction without blocking.
+ *
+ * Completion is signaled by calling `xfer->on_done` from the ISR or, if it is NULL,
+ * by a task notification to the calling task. Can be called from an ISR when
+ * `xfer->on_done` is set.
+ *
+ * \return false if another transaction is in progress.
+ */
+bool i2c_engine_start(i2c_xfer_t *xfer);
+
+/**
+ * Execute a transaction, blocking the calling task (without using the CPU) until it
+ * completes or the timeout expires.
+ *
+ * \return the final transaction status.
+ */
+i2c_xfer_status_t i2c_engine_transfer(i2c_xfer_t *xfer, TickType_t timeout);
+
+/** Abort the transaction in progress, if any, releasing the bus. Can be called from an ISR. */
+void i2c_engine_abort();
+
+/**
+ * Return true if the last transaction did not end with a stop condition, ie: a task is in
+ * the middle of a sequence of transactions and the next one will start with a repeated
+ * start.
+ */
+bool i2c_engine_bus_held();
+
+#endif
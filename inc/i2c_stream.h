@@ -0,0 +1,64 @@
+#ifndef I2C_STREAM_H
+#define I2C_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/** Maximum amount of bytes per sample. */
+#define I2C_STREAM_NBYTES_MAX 16
+/** Maximum sample rate (Hz). */
+#define I2C_STREAM_RATE_MAX 5000
+
+/**
+ * Stream record: a timestamp in microseconds since the stream started (little endian
+ * `uint32_t`) followed by the sample bytes.
+ */
+#define I2C_STREAM_RECORD_SIZE(nbytes) (sizeof(uint32_t) + (nbytes))
+
+/** Stream statistics. */
+typedef struct {
+    /** Samples stored in the buffer. */
+    uint32_t samples;
+    /**
+     * Samples dropped because the previous transaction was still in progress, or the bus
+     * was in use by a task.
+     */
+    uint32_t overruns;
+    /** Samples dropped because the buffer was full. */
+    uint32_t full;
+    /** Failed transactions, including the ones aborted after a timeout. */
+    uint32_t errors;
+} i2c_stream_stats_t;
+
+/**
+ * Start sampling nbytes bytes from register reg of the given device, rate_hz times per
+ * second, into the stream buffer. Any previous stream data is discarded.
+ *
+ * \return false if the parameters are out of range or the stream is already running.
+ */
+bool i2c_stream_start(uint8_t address, uint8_t reg, size_t nbytes, unsigned rate_hz);
+
+/** Stop sampling. The buffered records can still be read. */
+void i2c_stream_stop();
+
+/** Return true if the stream is running. */
+bool i2c_stream_running();
+
+/** Return the size of each record of the current stream. */
+size_t i2c_stream_record_size();
+
+/** Return the amount of buffered records. */
+size_t i2c_stream_available();
+
+/**
+ * Read whole records from the stream buffer.
+ *
+ * \return the amount of bytes read (a multiple of the record size).
+ */
+size_t i2c_stream_read(uint8_t data[], size_t nbytes);
+
+/** Get a snapshot of the stream statistics. */
+i2c_stream_stats_t i2c_stream_stats();
+
+#endif
@@ -6,4 +6,7 @@
 /** `irq` command definition. */
 extern const cmd_t irq_command;
 
+/** Return true if the name tables of the `irq` command are correctly sorted. */
+bool irq_tables_sorted();
+
 #endif
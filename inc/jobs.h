@@ -0,0 +1,34 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <stdbool.h>
+#include "cli.h"
+
+/** Create the job queue and the worker tasks that run background jobs. */
+bool jobs_init();
+
+/**
+ * Queue a command to run on a background worker task (`<command...> &`).
+ *
+ * \param args The command line.
+ * \param ntokens Amount of tokens of args that make up the command (ie: without `&`).
+ */
+void jobs_submit(const cmd_args_t *args, int ntokens);
+
+/**
+ * Return true if the calling task is running a job stopped with `kill`. Command handlers
+ * that may run for long (eg: `sleep`, `spi bench`) poll it, and return as soon as it is
+ * true; the job is then reported as killed.
+ */
+bool jobs_killed();
+
+/** `jobs` command definition. */
+extern const cmd_t jobs_command;
+
+/** `wait` command definition. */
+extern const cmd_t wait_command;
+
+/** `kill` command definition. */
+extern const cmd_t kill_command;
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <stdint.h>
+#include "cli.h"
+#include "log_messages.h"
+
+/**
+ * Deferred binary log.
+ *
+ * Each record holds only a message id, up to LOG_ARGS_MAX integer arguments and a cycle
+ * counter timestamp, stored in a RAM ring buffer in a few dozen cycles; the text is
+ * formatted on the host by `tools/logdecode.py` from the message list in
+ * `log_messages.h`. Cheap enough to record events from ISRs and hot paths, where
+ * printing would take hundreds of microseconds of UART time.
+ *
+ * The `log` command dumps the records in binary format.
+ */
+
+/** Maximum amount of arguments of a message */
+#define LOG_ARGS_MAX 4
+
+/** Message ids, from `LOG_MESSAGE_LIST`. */
+typedef enum {
+#define LOG_MESSAGE_ID(id, format) id,
+    LOG_MESSAGE_LIST(LOG_MESSAGE_ID)
+#undef LOG_MESSAGE_ID
+    LOG_MESSAGE_COUNT
+} log_message_t;
+
+/** A log record, as stored and dumped (little endian). */
+typedef struct {
+    /** Cycle counter when the message was recorded. */
+    uint32_t cycles;
+    /** Message id. */
+    uint16_t message;
+    /** Sequence number of the record, to detect dropped records. */
+    uint16_t sequence;
+    /** Message arguments. */
+    uint32_t args[LOG_ARGS_MAX];
+} log_record_t;
+
+/**
+ * Record a message. Missing arguments are recorded as 0. Safe to call from an ISR. If the
+ * buffer is full, the record is dropped (and counted).
+ */
+void log_record(log_message_t message, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3);
+
+/** Record a message with 0 to LOG_ARGS_MAX arguments, eg: `LOG(LOG_IRQ_LOST, channel)`. */
+#define LOG(...) LOG_(__VA_ARGS__, 0, 0, 0, 0)
+#define LOG_(message, a0, a1, a2, a3, ...) \
+    log_record((message), (uint32_t)(a0), (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3))
+
+/** `log` command definition. */
+extern const cmd_t log_command;
+
+#endif
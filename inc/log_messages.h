@@ -0,0 +1,27 @@
+#ifndef LOG_MESSAGES_H
+#define LOG_MESSAGES_H
+
+/**
+ * Messages of the deferred log (see `log.h`): `X(id, format)`.
+ *
+ * Only the message id is recorded, so the firmware does not contain these strings;
+ * `tools/logdecode.py` reads this list to format the records. Ids are assigned in order:
+ * append new messages at the end, and never reuse a removed message's slot for a
+ * different format.
+ *
+ * Formats take up to LOG_ARGS_MAX unsigned 32-bit arguments: `%u`, `%d`, `%x` (with
+ * optional flags and width) or `%{name0,name1,...}`, which prints the name at the index
+ * given by the argument.
+ */
+#define LOG_MESSAGE_LIST(X) \
+    X(LOG_IRQ_EVENT, "irq %u: %{raising,falling,both,high,low} at %u ms, %u events merged") \
+    X(LOG_IRQ_LOST, "irq %u: event lost, queue full") \
+    X(LOG_I2C_STREAM_OVERRUN, "i2c stream: overrun at %u us") \
+    X(LOG_I2C_STREAM_ERROR, "i2c stream: sample failed, status %{busy,done,nack,error,timeout}") \
+    X(LOG_DMA_ERROR, "dma %u: transfer error") \
+    X(LOG_POOL_EXHAUSTED, "pool exhausted (blocks of %u bytes)") \
+    X(LOG_TERMINAL_DROPPED, "terminal: %u bytes of background output dropped") \
+    X(LOG_JOB_START, "job %u started") \
+    X(LOG_JOB_END, "job %u %{done,killed}")
+
+#endif
@@ -0,0 +1,49 @@
+#ifndef LOOKUP_H
+#define LOOKUP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Lookup by name in constant tables (eg: pin names, subcommand names).
+ *
+ * A table is an array of structs whose first member is the `const char *` name, sorted by
+ * name in `strcmp` order: digits before uppercase letters, uppercase before lowercase, and
+ * a prefix before the longer names (eg: `LED1`, `LEDB`, `TEC1`, `r`, `read`). Tables are
+ * `const`, so they stay in flash, and lookups are binary searches.
+ */
+
+/** Amount of elements of an array. */
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+/**
+ * Find an element by name in a sorted table of count elements of the given size.
+ *
+ * \return the element, or NULL if not found.
+ */
+const void *lookup_name(const char *name, const void *table, size_t count, size_t size);
+
+/** Find an element by name in a sorted table, given as an array. */
+#define LOOKUP(table, name) lookup_name((name), (table), ARRAY_SIZE(table), sizeof((table)[0]))
+
+/**
+ * Find an element by name in a sorted table of count pointers to the elements (eg: the
+ * `commands` list).
+ *
+ * \return the element, or NULL if not found.
+ */
+const void *lookup_name_indirect(const char *name, const void *const table[], size_t count);
+
+/**
+ * Return true if a table of count elements of the given size is sorted, with no repeated
+ * names. A misplaced element would not be found, so tables are checked at startup.
+ */
+bool lookup_sorted(const void *table, size_t count, size_t size);
+
+/** Check the order of a table, given as an array (see lookup_sorted). */
+#define LOOKUP_SORTED(table) lookup_sorted((table), ARRAY_SIZE(table), sizeof((table)[0]))
+
+/** Return true if a table of count pointers to the elements is sorted (see lookup_sorted). */
+bool lookup_sorted_indirect(const void *const table[], size_t count);
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef LZSS_H
+#define LZSS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming LZSS compressor with a small, fixed memory footprint (see lzss_encoder_t).
+ *
+ * The output is a bit stream, most significant bit first, of:
+ *
+ * - literals: a `1` bit followed by the byte (8 bits);
+ * - matches: a `0` bit, `distance - 1` (LZSS_WINDOW_BITS bits) and
+ *   `length - LZSS_MATCH_MIN` (LZSS_LENGTH_BITS bits), meaning "copy length bytes
+ *   starting distance bytes back". A match may overlap the bytes it produces.
+ *
+ * The last byte is padded with zero bits, which are fewer than any token.
+ */
+
+/** Log2 of the amount of previous bytes searched for matches */
+#define LZSS_WINDOW_BITS 8
+/** Bits of the length of a match */
+#define LZSS_LENGTH_BITS 4
+/** Amount of previous bytes searched for matches */
+#define LZSS_WINDOW (1 << LZSS_WINDOW_BITS)
+/** Shortest match; shorter ones are cheaper as literals */
+#define LZSS_MATCH_MIN 2
+/** Longest match */
+#define LZSS_MATCH_MAX (LZSS_MATCH_MIN + (1 << LZSS_LENGTH_BITS) - 1)
+/** Amount of compressed bytes passed to the output function at a time (at most) */
+#define LZSS_OUTPUT_CHUNK 64
+
+/** Consume nbytes bytes of compressed output. */
+typedef void (*lzss_output_t)(void *context, const uint8_t data[], size_t nbytes);
+
+/** Compressor state. */
+typedef struct {
+    /** Bytes already encoded (the search window) followed by the pending input. */
+    uint8_t window[2 * LZSS_WINDOW];
+    /** Position in window of the next byte to encode. */
+    size_t pos;
+    /** Amount of bytes in window. */
+    size_t end;
+    /** Bits not yet written to out, in the lowest nbits bits. */
+    uint32_t bits;
+    /** Amount of pending bits. */
+    unsigned nbits;
+    /** Compressed output not yet passed to the output function. */
+    uint8_t out[LZSS_OUTPUT_CHUNK];
+    /** Amount of bytes in out. */
+    size_t nout;
+    /** Output function. */
+    lzss_output_t output;
+    /** Argument for the output function. */
+    void *context;
+} lzss_encoder_t;
+
+/** Start a new compressed stream, passing its output to the given function. */
+void lzss_init(lzss_encoder_t *encoder, lzss_output_t output, void *context);
+
+/**
+ * Compress nbytes bytes. The output lags behind the input by up to LZSS_MATCH_MAX bytes,
+ * plus up to LZSS_OUTPUT_CHUNK compressed bytes.
+ */
+void lzss_feed(lzss_encoder_t *encoder, const void *data, size_t nbytes);
+
+/** Compress the pending input and flush all the output, ending the stream. */
+void lzss_finish(lzss_encoder_t *encoder);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "cli.h"
+
+/**
+ * Fixed-size block pool.
+ *
+ * Hands out blocks of a fixed size from a statically allocated storage area, in O(1) and
+ * without using the heap. Free blocks are kept in a singly linked list threaded through
+ * the blocks themselves. Allocating and freeing are safe from any task and from ISRs.
+ */
+
+/** Round a block size up so that every block is aligned for any type. */
+#define POOL_BLOCK_SIZE(size) (((size) + sizeof(uint64_t) - 1) / sizeof(uint64_t) * sizeof(uint64_t))
+
+/**
+ * Define a static pool of nblocks blocks of the given size, along with its storage.
+ * The pool is initialized on its first use.
+ *
+ * Eg: `POOL_DEFINE(rx_pool, "i2c rx", 256, 4);`
+ */
+#define POOL_DEFINE(var, pool_name, size, nblocks) \
+    static uint64_t var##_storage[POOL_BLOCK_SIZE(size) / sizeof(uint64_t) * (nblocks)]; \
+    static pool_t var = { \
+        .name = pool_name, \
+        .storage = var##_storage, \
+        .block_size = POOL_BLOCK_SIZE(size), \
+        .stats = {.blocks = (nblocks), .free = (nblocks), .free_min = (nblocks)}, \
+    }
+
+/** Pool statistics. */
+typedef struct {
+    /** Total amount of blocks. */
+    uint32_t blocks;
+    /** Amount of blocks currently free. */
+    uint32_t free;
+    /** Lowest amount of free blocks ever seen. */
+    uint32_t free_min;
+    /** Successful allocations. */
+    uint32_t allocs;
+    /** Allocations that failed because the pool was exhausted. */
+    uint32_t exhausted;
+} pool_stats_t;
+
+/** A free block: the link to the next one is stored inside the block. */
+typedef struct pool_block {
+    struct pool_block *next;
+} pool_block_t;
+
+/** Pool state. Use `POOL_DEFINE` to create one. */
+typedef struct pool {
+    /** Name, shown by the `pool` command. */
+    const char *name;
+    /** Storage for all the blocks. */
+    void *storage;
+    /** Size of each block (bytes). */
+    size_t block_size;
+    /** First free block, or NULL if exhausted. */
+    pool_block_t *free_list;
+    /** True once the free list has been built. */
+    bool initialized;
+    /** Statistics. */
+    pool_stats_t stats;
+    /** Next pool in the list of pools shown by the `pool` command. */
+    struct pool *next;
+} pool_t;
+
+/**
+ * Take a block from the pool. Safe to call from an ISR.
+ *
+ * \return the block, or NULL if the pool is exhausted.
+ */
+void *pool_alloc(pool_t *pool);
+
+/** Return a block to the pool. Safe to call from an ISR. Does nothing if block is NULL. */
+void pool_free(pool_t *pool, void *block);
+
+/** Return a snapshot of the pool statistics. */
+pool_stats_t pool_stats(const pool_t *pool);
+
+/** `pool` command definition. */
+extern const cmd_t pool_command;
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef RINGBUF_H
+#define RINGBUF_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Byte ring buffer.
+ *
+ * Safe without locking for a single producer and a single consumer (eg: an ISR writing
+ * and a task reading), since the producer only updates `head` and the consumer only
+ * updates `tail`.
+ */
+typedef struct {
+    /** Storage. */
+    uint8_t *buf;
+    /** Storage size (bytes). Must be a power of 2. */
+    size_t size;
+    /** Total amount of bytes written (wraps around). */
+    volatile size_t head;
+    /** Total amount of bytes read (wraps around). */
+    volatile size_t tail;
+} ringbuf_t;
+
+/** Initialize an empty ring buffer on the given storage; size must be a power of 2. */
+void ringbuf_init(ringbuf_t *rb, uint8_t *buf, size_t size);
+
+/** Return the amount of bytes available for reading. */
+size_t ringbuf_used(const ringbuf_t *rb);
+
+/** Return the amount of bytes that can be written. */
+size_t ringbuf_free(const ringbuf_t *rb);
+
+/**
+ * Write nbytes bytes, only if all of them fit.
+ *
+ * \return false if there is not enough free space.
+ */
+bool ringbuf_put(ringbuf_t *rb, const void *data, size_t nbytes);
+
+/**
+ * Read up to nbytes bytes.
+ *
+ * \return the amount of bytes read.
+ */
+size_t ringbuf_get(ringbuf_t *rb, void *data, size_t nbytes);
+
+/** Discard all data. Must be called by the consumer. */
+void ringbuf_clear(ringbuf_t *rb);
+
+#endif
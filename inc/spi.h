@@ -0,0 +1,9 @@
+#ifndef SPI_H
+#define SPI_H
+
+#include "cli.h"
+
+/** `spi` command definition. */
+extern const cmd_t spi_command;
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef SPI_ENGINE_H
+#define SPI_ENGINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+
+/**
+ * SPI master driver on SSP1, with both directions moved by GPDMA.
+ *
+ * The calling task is blocked (without using CPU) until the receive DMA channel reports
+ * that the last byte arrived. The engine is not synchronized: callers must serialize
+ * transfers (eg: with the spi bus mutex).
+ */
+
+/** Result of a transfer. */
+typedef enum {
+    /** All bytes were transferred. */
+    SPI_XFER_DONE,
+    /** The DMA controller reported an error, or the transfer could not be started. */
+    SPI_XFER_ERROR,
+    /** The transfer did not finish in time, and was aborted. */
+    SPI_XFER_TIMEOUT,
+} spi_xfer_status_t;
+
+/**
+ * Configure the SSP peripheral and reserve its DMA channels.
+ *
+ * \param freq_hz Requested clock frequency; the closest lower one available is used.
+ * \param mode SPI mode (0 to 3), which selects the clock polarity and phase.
+ *
+ * \return false if the parameters are out of range or no DMA channels are available.
+ */
+bool spi_engine_init(uint32_t freq_hz, uint8_t mode);
+
+/** Return the highest clock frequency supported by the peripheral (Hz). */
+uint32_t spi_engine_max_freq();
+
+/** Return the clock frequency actually configured (Hz), or 0 if not initialized. */
+uint32_t spi_engine_freq();
+
+/**
+ * Perform a full-duplex transfer, blocking the calling task until it completes.
+ *
+ * Each byte is received after it was sent, so rx_data may be the same buffer as tx_data
+ * (the received data then replaces the transmitted data).
+ *
+ * \param tx_data Data to transmit.
+ * \param rx_data Buffer for the received data, with room for nbytes.
+ * \param nbytes Amount of bytes to transfer in each direction.
+ * \param timeout Maximum time to wait for the whole transfer.
+ */
+spi_xfer_status_t spi_engine_transfer(const uint8_t *tx_data, uint8_t *rx_data, size_t nbytes, TickType_t timeout);
+
+#endif
@@ -3,6 +3,8 @@
 
 /** RTOS priority for the CLI task */
 #define CLI_TASK_PRIORITY        tskIDLE_PRIORITY + 1
+/** RTOS priority for the worker tasks that run background jobs (`<command> &`). */
+#define JOB_TASK_PRIORITY        tskIDLE_PRIORITY + 1
 /** RTOS priority for all tasks spawned by the `irq` command. */
 #define IRQ_TASK_PRIORITY        tskIDLE_PRIORITY + 2
 /** RTOS priority for all tasks spawned by the `loop` command. */
@@ -3,6 +3,9 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "cli.h"
 
 /** Initialize the RTOS task, interrupt and queues for controlling the terminal I/O. */
 bool terminal_init();
@@ -13,11 +16,89 @@ void terminal_putc(const char c);
 void terminal_puts(const char s[]);
 /** Write a string to the terminal, appending `'\\r\\n'`. */
 void terminal_println(const char s[]);
+/** Write nbytes bytes of (possibly binary) data to the terminal. */
+void terminal_write(const void *data, size_t nbytes);
+
+/**
+ * Destination for the output of a task, instead of the UART (eg: a RAM buffer).
+ *
+ * Embed it as the first member of a struct to keep the sink state.
+ */
+typedef struct terminal_sink {
+    /** Consume nbytes bytes of output. Called from the task that produced them. */
+    void (*write)(struct terminal_sink *sink, const void *data, size_t nbytes);
+} terminal_sink_t;
+
+/** Return the output sink of the calling task, or NULL if it writes to the UART. */
+terminal_sink_t *terminal_get_sink();
+
+/**
+ * Redirect the output of the calling task to the given sink, or to the UART if NULL.
+ *
+ * \return the previous sink.
+ */
+terminal_sink_t *terminal_set_sink(terminal_sink_t *sink);
+
+/** Token bucket limiting the output of a background task. */
+typedef struct {
+    /** Bytes that can be written right now. */
+    uint32_t tokens;
+    /** Tick count of the last time tokens were added. */
+    TickType_t last_refill;
+    /** Bytes dropped since the last output that was written. */
+    uint32_t dropped;
+} terminal_limiter_t;
+
+/**
+ * Mark the output of the calling task as background output, limited by the given token
+ * bucket; or as interactive output if limiter is NULL (the default).
+ *
+ * Interactive output is always written before any pending background output. Background
+ * output never blocks: what exceeds the rate limit (see `terminal limit`) is dropped, and
+ * a summary with the amount of dropped bytes is printed before the next output.
+ */
+void terminal_set_background(terminal_limiter_t *limiter);
+
+/**
+ * Start writing binary data (eg: `log dump`): hold all background output until
+ * terminal_end_binary, so that it is not interleaved with the data. Meanwhile, background
+ * output is still queued, or dropped when the queue is full. Calls nest.
+ *
+ * Binary data written as background output to the UART would be held too, and then
+ * dropped by the rate limit, so it must be redirected to a buffer instead.
+ *
+ * \return false, after printing an error, if the calling task writes background output
+ *         to the UART. Then terminal_end_binary must not be called.
+ */
+bool terminal_begin_binary();
+
+/** Finish writing binary data, releasing the background output. */
+void terminal_end_binary();
+
+/** Output statistics. */
+typedef struct {
+    /** Bytes of interactive output. */
+    uint32_t interactive;
+    /** Bytes of background output. */
+    uint32_t background;
+    /** Bytes of background output dropped. */
+    uint32_t dropped;
+} terminal_stats_t;
+
+/** `terminal` command definition. */
+extern const cmd_t terminal_command;
 
 /** Read a single character from the terminal. */
 char terminal_getc();
 /** Read at most bufsize bytes from the terminal, or until a newline (included in the returned buffer). */
 void terminal_gets(char buf[], size_t bufsize);
+/**
+ * Read exactly nbytes bytes of (possibly binary) data from the terminal, waiting at most
+ * timeout_ms for each byte.
+ *
+ * \return the amount of bytes read, less than nbytes if the timeout expired.
+ */
+size_t terminal_read(void *data, size_t nbytes, unsigned timeout_ms);
 
 /** Print an error message. */
 #define log_error(msg) terminal_println("Error: " msg)
@@ -0,0 +1,50 @@
+#ifndef TOKENIZER_H
+#define TOKENIZER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "cli.h"
+
+/** Result of feeding a character to the tokenizer. */
+typedef enum {
+    /** The line is not complete yet. */
+    TOKENIZER_MORE,
+    /** A complete line was parsed into the cmd_args_t. */
+    TOKENIZER_LINE,
+    /** The line ended, but it did not fit in CLI_LINE_MAX. */
+    TOKENIZER_TOO_LONG,
+    /** The line ended, but it had CLI_ARGC_MAX or more arguments. */
+    TOKENIZER_TOO_MANY_ARGS,
+} tokenizer_status_t;
+
+/**
+ * Incremental command line parser, fed one character at a time as they arrive.
+ *
+ * Arguments are separated by blanks, and stored in `args` (null terminated, with their
+ * `tokens` pointers) as soon as they are typed, so the line is ready to be executed when
+ * the newline arrives. An over-long line or too many arguments is detected as soon as
+ * it happens; the rest of the line is then discarded, and the error reported at its end.
+ */
+typedef struct {
+    /** Output. */
+    cmd_args_t *args;
+    /** Amount of bytes stored in `args->buf`. */
+    size_t len;
+    /** True if the last character stored belongs to an argument. */
+    bool in_token;
+    /** Error detected in the current line, or TOKENIZER_MORE if none. */
+    tokenizer_status_t error;
+} tokenizer_t;
+
+/** Start parsing a new line into args. */
+void tokenizer_init(tokenizer_t *tokenizer, cmd_args_t *args);
+
+/**
+ * Feed a character to the tokenizer. A line ends with `\n`; `\r` is ignored.
+ *
+ * \return TOKENIZER_MORE until the line ends, and then the result. The tokenizer must
+ *         be initialized again before parsing another line.
+ */
+tokenizer_status_t tokenizer_feed(tokenizer_t *tokenizer, char c);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef WATCH_H
+#define WATCH_H
+
+#include "cli.h"
+
+/** `watch` command definition. */
+extern const cmd_t watch_command;
+
+#endif
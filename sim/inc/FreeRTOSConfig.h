@@ -0,0 +1,60 @@
+#ifndef FREERTOS_CONFIG_H
+#define FREERTOS_CONFIG_H
+
+/*
+ * FreeRTOS configuration of the host simulator (POSIX port). The application settings
+ * are the same as in ../../inc/FreeRTOSConfig.h; stack and heap sizes are larger
+ * because each task runs on a pthread.
+ */
+
+#define configUSE_PREEMPTION                         1
+#define configUSE_IDLE_HOOK                          0
+#define configUSE_TICK_HOOK                          0
+#define configUSE_TICKLESS_IDLE                      0
+#define configTICK_RATE_HZ                           ( ( TickType_t ) 1000 ) // 1000 ticks per second => 1ms tick rate
+#define configMAX_PRIORITIES                         ( 7 )
+// pthreads need at least PTHREAD_STACK_MIN (16 KB); StackType_t is 8 bytes wide
+#define configMINIMAL_STACK_SIZE                     ( ( uint16_t ) 4096 )
+#define configSUPPORT_STATIC_ALLOCATION              0
+#define configSUPPORT_DYNAMIC_ALLOCATION             1
+#define configTOTAL_HEAP_SIZE                        ( ( size_t ) ( 16 * 1024 * 1024 ) )
+#define configMAX_TASK_NAME_LEN                      ( 16 )
+#define configUSE_TRACE_FACILITY                     1
+#define configUSE_16_BIT_TICKS                       0
+#define configIDLE_SHOULD_YIELD                      1
+#define configUSE_MUTEXES                            1
+#define configQUEUE_REGISTRY_SIZE                    8
+#define configCHECK_FOR_STACK_OVERFLOW               0
+#define configUSE_RECURSIVE_MUTEXES                  1
+#define configUSE_MALLOC_FAILED_HOOK                 1
+#define configUSE_APPLICATION_TASK_TAG               0
+#define configUSE_COUNTING_SEMAPHORES                1
+#define configGENERATE_RUN_TIME_STATS                0
+#define configNUM_THREAD_LOCAL_STORAGE_POINTERS      2    /* see terminal.c */
+#define configUSE_CO_ROUTINES                        0
+
+#define configUSE_TIMERS                             1
+#define configTIMER_TASK_PRIORITY                    ( configMAX_PRIORITIES - 3 )
+#define configTIMER_QUEUE_LENGTH                     10
+#define configTIMER_TASK_STACK_DEPTH                 ( configMINIMAL_STACK_SIZE * 2 )
+
+#define INCLUDE_vTaskPrioritySet                     1
+#define INCLUDE_uxTaskPriorityGet                    1
+#define INCLUDE_vTaskDelete                          1
+#define INCLUDE_vTaskCleanUpResources                0
+#define INCLUDE_vTaskSuspend                         1
+#define INCLUDE_vTaskDelayUntil                      1
+#define INCLUDE_vTaskDelay                           1
+#define INCLUDE_xTaskGetSchedulerState               1
+#define INCLUDE_xTaskGetCurrentTaskHandle            1
+#define INCLUDE_xTimerPendFunctionCall               1
+#define INCLUDE_xSemaphoreGetMutexHolder             1
+
+/* Interrupt priorities passed by the firmware to NVIC_SetPriority (ignored). */
+#define configLIBRARY_LOWEST_INTERRUPT_PRIORITY         0x7
+#define configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY    5
+
+void vAssertCalled( const char * file, unsigned long line );
+#define configASSERT( x )    if( ( x ) == 0 ) { vAssertCalled( __FILE__, __LINE__ ); }
+
+#endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,157 @@
+#ifndef CHIP_H
+#define CHIP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Simulated subset of LPCOpen for the LPC4337, with the peripherals used directly by the
+ * firmware: pin interrupts, RIT, ADC0 and the NVIC. Registers are plain memory; the
+ * functions update the simulated peripherals in sim/src.
+ */
+
+/** Core clock of the EDU-CIAA-NXP (Hz). */
+#define SIM_CORE_CLOCK 204000000
+
+extern uint32_t SystemCoreClock;
+
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+/** Interrupt numbers, with the same values as the LPC43xx. */
+typedef enum {
+    DMA_IRQn = 2,
+    RITIMER_IRQn = 11,
+    I2C0_IRQn = 18,
+    PIN_INT0_IRQn = 32,
+    PIN_INT1_IRQn = 33,
+    PIN_INT2_IRQn = 34,
+    PIN_INT3_IRQn = 35,
+    PIN_INT4_IRQn = 36,
+    PIN_INT5_IRQn = 37,
+    PIN_INT6_IRQn = 38,
+    PIN_INT7_IRQn = 39,
+} IRQn_Type;
+
+void NVIC_EnableIRQ(IRQn_Type irqn);
+void NVIC_DisableIRQ(IRQn_Type irqn);
+void NVIC_ClearPendingIRQ(IRQn_Type irqn);
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority);
+
+/** Clock sources for Chip_Clock_GetRate. */
+typedef enum {
+    CLK_MX_RITIMER,
+    CLK_APB3_ADC0,
+    CLK_MX_SSP1,
+} CHIP_CCU_CLK_T;
+
+uint32_t Chip_Clock_GetRate(CHIP_CCU_CLK_T clk);
+
+/** GPIO ports. */
+typedef struct {
+    uint32_t PIN[8];
+} LPC_GPIO_T;
+
+extern LPC_GPIO_T *LPC_GPIO_PORT;
+
+bool Chip_GPIO_GetPinState(LPC_GPIO_T *gpio, uint8_t port, uint8_t pin);
+
+/** Select the GPIO port and pin of pin interrupt channel PortSel. */
+void Chip_SCU_GPIOIntPinSel(uint8_t PortSel, uint8_t PortNum, uint8_t PinNum);
+
+/** Pin interrupt registers. */
+typedef struct {
+    /** Mode: 0 = edge, 1 = level. */
+    uint32_t ISEL;
+    /** Rising edge (edge mode) or interrupt (level mode) enable. */
+    uint32_t IENR;
+    /** Falling edge enable (edge mode) or active level (level mode: 1 = high). */
+    uint32_t IENF;
+    /** Rising edges detected. */
+    uint32_t RISE;
+    /** Falling edges detected. */
+    uint32_t FALL;
+    /** Interrupt status (edge mode). */
+    uint32_t IST;
+} LPC_PIN_INT_T;
+
+extern LPC_PIN_INT_T *LPC_GPIO_PIN_INT;
+
+#define PININTCH(ch) (1 << (ch))
+
+void Chip_PININT_SetPinModeEdge(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_SetPinModeLevel(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_EnableIntHigh(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_DisableIntHigh(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_EnableIntLow(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_DisableIntLow(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_ClearIntStatus(LPC_PIN_INT_T *regs, uint32_t pins);
+uint32_t Chip_PININT_GetRiseStates(LPC_PIN_INT_T *regs);
+uint32_t Chip_PININT_GetFallStates(LPC_PIN_INT_T *regs);
+void Chip_PININT_ClearRiseStates(LPC_PIN_INT_T *regs, uint32_t pins);
+void Chip_PININT_ClearFallStates(LPC_PIN_INT_T *regs, uint32_t pins);
+
+/** Repetitive interrupt timer registers. */
+typedef struct {
+    uint32_t COMPVAL;
+    uint32_t MASK;
+    uint32_t CTRL;
+    uint32_t COUNTER;
+} LPC_RITIMER_T;
+
+extern LPC_RITIMER_T *LPC_RITIMER;
+
+void Chip_RIT_Init(LPC_RITIMER_T *rit);
+void Chip_RIT_DeInit(LPC_RITIMER_T *rit);
+void Chip_RIT_Enable(LPC_RITIMER_T *rit);
+void Chip_RIT_Disable(LPC_RITIMER_T *rit);
+void Chip_RIT_SetCOMPVAL(LPC_RITIMER_T *rit, uint32_t val);
+void Chip_RIT_EnableCompClear(LPC_RITIMER_T *rit);
+void Chip_RIT_SetCounter(LPC_RITIMER_T *rit, uint32_t val);
+void Chip_RIT_ClearInt(LPC_RITIMER_T *rit);
+
+/** ADC registers. */
+typedef struct {
+    uint32_t CR;
+    uint32_t GDR;
+    uint32_t INTEN;
+    uint32_t DR[8];
+    uint32_t STAT;
+} LPC_ADC_T;
+
+extern LPC_ADC_T *LPC_ADC0;
+
+typedef struct {
+    uint32_t adcRate;
+    uint8_t bitsAccuracy;
+    bool burstMode;
+} ADC_CLOCK_SETUP_T;
+
+typedef enum {
+    ADC_CH0, ADC_CH1, ADC_CH2, ADC_CH3, ADC_CH4, ADC_CH5, ADC_CH6, ADC_CH7,
+} ADC_CHANNEL_T;
+
+/** Conversion result in an ADC data register. */
+#define ADC_DR_RESULT(n) (((n) >> 6) & 0x3FF)
+/** Conversion done flag in an ADC data register. */
+#define ADC_DR_DONE(n) (((n) >> 31))
+
+void Chip_ADC_Init(LPC_ADC_T *adc, ADC_CLOCK_SETUP_T *setup);
+void Chip_ADC_SetSampleRate(LPC_ADC_T *adc, ADC_CLOCK_SETUP_T *setup, uint32_t rate);
+void Chip_ADC_EnableChannel(LPC_ADC_T *adc, ADC_CHANNEL_T channel, FunctionalState state);
+void Chip_ADC_Int_SetChannelCmd(LPC_ADC_T *adc, uint8_t channel, FunctionalState state);
+void Chip_ADC_SetBurstCmd(LPC_ADC_T *adc, FunctionalState state);
+
+/** GPDMA peripheral connections. */
+typedef enum {
+    GPDMA_CONN_MEMORY = 0,
+    GPDMA_CONN_SSP1_Tx = 3,
+    GPDMA_CONN_SSP1_Rx = 4,
+    GPDMA_CONN_ADC_0 = 13,
+} GPDMA_CONN_T;
+
+#define GPDMA_TRANSFERTYPE_M2M_CONTROLLER_DMA 0
+#define GPDMA_TRANSFERTYPE_M2P_CONTROLLER_DMA 1
+#define GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA 2
+#define GPDMA_NUMBER_CHANNELS 8
+
+#endif
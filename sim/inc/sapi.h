@@ -0,0 +1,78 @@
+#ifndef SAPI_H
+#define SAPI_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "chip.h"
+
+/**
+ * Simulated subset of the sAPI library, for the host simulator. See sim/src.
+ */
+
+typedef uint8_t bool_t;
+
+#define FALSE 0
+#define TRUE 1
+#define OFF 0
+#define ON 1
+#define LOW 0
+#define HIGH 1
+
+/** Pins of the EDU-CIAA-NXP: sAPI name, GPIO port and GPIO pin. */
+#define SIM_PIN_LIST(X) \
+    X(TEC1, 0, 4) X(TEC2, 0, 8) X(TEC3, 0, 9) X(TEC4, 1, 9) \
+    X(LEDR, 5, 0) X(LEDG, 5, 1) X(LEDB, 5, 2) X(LED1, 0, 14) X(LED2, 1, 11) X(LED3, 1, 12) \
+    X(GPIO0, 3, 0) X(GPIO1, 3, 3) X(GPIO2, 3, 4) X(GPIO3, 5, 15) X(GPIO4, 5, 16) \
+    X(GPIO5, 3, 5) X(GPIO6, 3, 6) X(GPIO7, 3, 7) X(GPIO8, 2, 8) \
+    X(LCD1, 2, 4) X(LCD2, 2, 5) X(LCD3, 2, 6) X(LCD4, 5, 14) X(LCDRS, 5, 12) X(LCDEN, 5, 13)
+
+#define SIM_PIN_ENUM(name, port, pin) name,
+
+typedef enum {
+    SIM_PIN_LIST(SIM_PIN_ENUM)
+    SIM_PIN_COUNT
+} gpioMap_t;
+
+typedef enum {
+    GPIO_INPUT,
+    GPIO_OUTPUT,
+    GPIO_INPUT_PULLUP,
+    GPIO_INPUT_PULLDOWN,
+    GPIO_INPUT_PULLUP_PULLDOWN,
+    GPIO_ENABLE,
+} gpioInit_t;
+
+bool_t gpioInit(gpioMap_t pin, gpioInit_t config);
+bool_t gpioRead(gpioMap_t pin);
+bool_t gpioWrite(gpioMap_t pin, bool_t value);
+bool_t gpioToggle(gpioMap_t pin);
+
+typedef enum {
+    UART_GPIO,
+    UART_485,
+    UART_USB,
+    UART_ENET,
+    UART_232,
+} uartMap_t;
+
+typedef enum {
+    UART_RECEIVE,
+    UART_TRANSMITER_FREE,
+} uartEvents_t;
+
+typedef void (*callBackFuncPtr_t)(void *);
+
+void uartConfig(uartMap_t uart, uint32_t baudRate);
+void uartCallbackSet(uartMap_t uart, uartEvents_t event, callBackFuncPtr_t callback, void *param);
+void uartInterrupt(uartMap_t uart, bool_t enable);
+uint8_t uartRxRead(uartMap_t uart);
+void uartWriteByte(uartMap_t uart, uint8_t value);
+
+/** Initialize the simulated board and start the simulator task. */
+void boardInit(void);
+
+bool_t cyclesCounterInit(uint32_t clockSpeed);
+/** CPU cycles at SystemCoreClock, derived from the host monotonic clock. */
+uint32_t cyclesCounterRead(void);
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "sapi.h"
+
+/**
+ * Host simulator of the EDU-CIAA-NXP board.
+ *
+ * Interrupts are simulated by the sim task, which runs at the highest priority once per
+ * tick: it polls the host for UART input, applies the scripted GPIO edges, advances the
+ * timers and completes the DMA and I2C transfers, calling the firmware ISRs and
+ * callbacks as the hardware would. Since only one task runs at a time, the ISRs cannot
+ * interrupt a critical section of the firmware.
+ *
+ * Settings are read from environment variables:
+ *
+ * - `SIM_PTY=1`: use a pseudo-terminal for the UART, instead of stdin/stdout.
+ * - `SIM_BAUD=<n>`: UART speed (default: as configured by the firmware); 0 = unlimited.
+ * - `SIM_LINGER_MS=<n>`: time to keep running after the end of stdin (default 1000).
+ * - `SIM_GPIO_SCRIPT=<file>`: GPIO edges to apply (see sim_gpio.c).
+ * - `SIM_TRACE=1`: print GPIO changes and other events to stderr, with timestamps.
+ */
+
+/** Time since the simulator started (ns), from the host monotonic clock. */
+uint64_t sim_now_ns();
+
+/** Time since the simulator started (ms). */
+uint32_t sim_now_ms();
+
+/** Return the value of an integer environment variable, or def if not set. */
+long sim_env(const char *name, long def);
+
+/** Print a line to stderr, with a timestamp, if SIM_TRACE is set. */
+void sim_trace(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+/** Return true if the interrupt is enabled in the simulated NVIC. */
+bool sim_irq_enabled(IRQn_Type irqn);
+
+/** Return the ADC0 sample rate (Hz), or 0 if not configured. */
+uint32_t sim_adc_rate();
+
+/** Return the ADC0 data register for sample n of the enabled channel (a test signal). */
+uint32_t sim_adc_sample(uint32_t n);
+
+/** Set a pin level, latching the pin interrupt edges. */
+void sim_gpio_set(gpioMap_t pin, bool level);
+
+/** Peripheral initialization, called from boardInit. */
+void sim_uart_init();
+void sim_gpio_init();
+
+/** Peripheral simulation step, called by the sim task every tick. */
+void sim_uart_step();
+void sim_gpio_step();
+void sim_rit_step();
+void sim_dma_step();
+void sim_i2c_step();
+
+/** Print the UART statistics to stderr. */
+void sim_uart_summary();
+
+#endif
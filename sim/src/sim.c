@@ -0,0 +1,94 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Priority of the sim task: above all firmware tasks, like an interrupt. */
+#define SIM_TASK_PRIORITY (configMAX_PRIORITIES - 1)
+
+uint32_t SystemCoreClock = SIM_CORE_CLOCK;
+
+/** Host monotonic clock when the simulator started (ns). */
+static uint64_t start_ns;
+
+/** True if SIM_TRACE is set. */
+static bool trace;
+
+static uint64_t monotonic_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+uint64_t sim_now_ns() {
+    return monotonic_ns() - start_ns;
+}
+
+uint32_t sim_now_ms() {
+    return sim_now_ns() / 1000000;
+}
+
+long sim_env(const char *name, long def) {
+    const char *value = getenv(name);
+    return value && *value ? strtol(value, NULL, 0) : def;
+}
+
+void sim_trace(const char *fmt, ...) {
+    if (!trace) {
+        return;
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "[%llu us] ", (unsigned long long)(sim_now_ns() / 1000));
+    vfprintf(stderr, fmt, ap);
+    fputc('\n', stderr);
+    va_end(ap);
+}
+
+/** RTOS task that simulates the peripherals and their interrupts, once per tick. */
+static void sim_task(void *param) {
+    TickType_t last_wake = xTaskGetTickCount();
+    while (1) {
+        sim_uart_step();
+        sim_gpio_step();
+        sim_rit_step();
+        sim_i2c_step();
+        sim_dma_step();
+        vTaskDelayUntil(&last_wake, 1);
+    }
+}
+
+void boardInit(void) {
+    start_ns = monotonic_ns();
+    trace = sim_env("SIM_TRACE", 0);
+
+    sim_uart_init();
+    sim_gpio_init();
+
+    if (xTaskCreate(sim_task, "sim", configMINIMAL_STACK_SIZE, NULL, SIM_TASK_PRIORITY, NULL) != pdPASS) {
+        fprintf(stderr, "sim: failed to create task\n");
+        exit(1);
+    }
+}
+
+bool_t cyclesCounterInit(uint32_t clockSpeed) {
+    return TRUE;
+}
+
+uint32_t cyclesCounterRead(void) {
+    // wraps around like the DWT cycle counter
+    return sim_now_ns() * (SystemCoreClock / 1000000) / 1000;
+}
+
+void vAssertCalled(const char *file, unsigned long line) {
+    fprintf(stderr, "sim: assertion failed at %s:%lu\n", file, line);
+    abort();
+}
+
+void vApplicationMallocFailedHook(void) {
+    fprintf(stderr, "sim: out of FreeRTOS heap\n");
+    abort();
+}
@@ -0,0 +1,155 @@
+#include <math.h>
+#include "sim.h"
+#include "FreeRTOS.h"
+
+/**
+ * Simulated NVIC, RIT and ADC0.
+ */
+
+/** RIT interrupts delivered per tick at most, to keep a bad period from stalling. */
+#define RIT_FIRES_MAX 100
+/** Amplitude of the ADC test signal (counts). */
+#define ADC_SIGNAL_AMPLITUDE 400
+/** Offset of the ADC test signal (counts). */
+#define ADC_SIGNAL_OFFSET 512
+/** Frequency of the ADC test signal on channel 1 (Hz); channel n has n times this. */
+#define ADC_SIGNAL_FREQ 50
+
+#define RIT_CTRL_INT (1 << 0)
+#define RIT_CTRL_ENCLR (1 << 1)
+#define RIT_CTRL_TEN (1 << 3)
+
+/** Enabled interrupts, one bit per IRQn. */
+static uint64_t nvic_enabled;
+
+static LPC_RITIMER_T rit_regs;
+LPC_RITIMER_T *LPC_RITIMER = &rit_regs;
+
+static LPC_ADC_T adc_regs;
+LPC_ADC_T *LPC_ADC0 = &adc_regs;
+
+/** Configured ADC sample rate (Hz). */
+static uint32_t adc_rate;
+
+/** Firmware RIT ISR (i2c_stream.c). */
+void RIT_IRQHandler();
+
+void NVIC_EnableIRQ(IRQn_Type irqn) {
+    nvic_enabled |= 1ULL << irqn;
+}
+
+void NVIC_DisableIRQ(IRQn_Type irqn) {
+    nvic_enabled &= ~(1ULL << irqn);
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irqn) {
+    // interrupts are requested by the peripheral state, checked on each tick
+}
+
+void NVIC_SetPriority(IRQn_Type irqn, uint32_t priority) {
+}
+
+bool sim_irq_enabled(IRQn_Type irqn) {
+    return nvic_enabled & (1ULL << irqn);
+}
+
+uint32_t Chip_Clock_GetRate(CHIP_CCU_CLK_T clk) {
+    return SystemCoreClock;
+}
+
+void Chip_RIT_Init(LPC_RITIMER_T *rit) {
+    *rit = (LPC_RITIMER_T) {0};
+}
+
+void Chip_RIT_DeInit(LPC_RITIMER_T *rit) {
+    *rit = (LPC_RITIMER_T) {0};
+}
+
+void Chip_RIT_Enable(LPC_RITIMER_T *rit) {
+    rit->CTRL |= RIT_CTRL_TEN;
+}
+
+void Chip_RIT_Disable(LPC_RITIMER_T *rit) {
+    rit->CTRL &= ~RIT_CTRL_TEN;
+}
+
+void Chip_RIT_SetCOMPVAL(LPC_RITIMER_T *rit, uint32_t val) {
+    rit->COMPVAL = val;
+}
+
+void Chip_RIT_EnableCompClear(LPC_RITIMER_T *rit) {
+    rit->CTRL |= RIT_CTRL_ENCLR;
+}
+
+void Chip_RIT_SetCounter(LPC_RITIMER_T *rit, uint32_t val) {
+    rit->COUNTER = val;
+}
+
+void Chip_RIT_ClearInt(LPC_RITIMER_T *rit) {
+    rit->CTRL &= ~RIT_CTRL_INT;
+}
+
+/**
+ * Advance the RIT counter by one tick, calling the ISR on each match. An I2C transaction
+ * started by the ISR completes before the next match, as it would on a bus fast enough
+ * for the sample rate.
+ */
+void sim_rit_step() {
+    if (!(rit_regs.CTRL & RIT_CTRL_TEN) || rit_regs.COMPVAL == 0) {
+        return;
+    }
+    uint64_t counter = (uint64_t)rit_regs.COUNTER + Chip_Clock_GetRate(CLK_MX_RITIMER) / configTICK_RATE_HZ;
+    for (int fires = 0; counter >= rit_regs.COMPVAL && fires < RIT_FIRES_MAX; fires++) {
+        counter -= rit_regs.COMPVAL;
+        rit_regs.CTRL |= RIT_CTRL_INT;
+        if (sim_irq_enabled(RITIMER_IRQn)) {
+            RIT_IRQHandler();
+            sim_i2c_step();
+        }
+        if (!(rit_regs.CTRL & RIT_CTRL_TEN)) {
+            return;
+        }
+    }
+    rit_regs.COUNTER = counter % rit_regs.COMPVAL;
+}
+
+void Chip_ADC_Init(LPC_ADC_T *adc, ADC_CLOCK_SETUP_T *setup) {
+    *adc = (LPC_ADC_T) {0};
+    *setup = (ADC_CLOCK_SETUP_T) {.adcRate = 400000, .bitsAccuracy = 10};
+    adc_rate = setup->adcRate;
+}
+
+void Chip_ADC_SetSampleRate(LPC_ADC_T *adc, ADC_CLOCK_SETUP_T *setup, uint32_t rate) {
+    setup->adcRate = rate;
+    adc_rate = rate;
+}
+
+void Chip_ADC_EnableChannel(LPC_ADC_T *adc, ADC_CHANNEL_T channel, FunctionalState state) {
+    if (state) {
+        adc->CR |= 1 << channel;
+    } else {
+        adc->CR &= ~(1 << channel);
+    }
+}
+
+void Chip_ADC_Int_SetChannelCmd(LPC_ADC_T *adc, uint8_t channel, FunctionalState state) {
+    if (state) {
+        adc->INTEN |= 1 << channel;
+    } else {
+        adc->INTEN &= ~(1 << channel);
+    }
+}
+
+void Chip_ADC_SetBurstCmd(LPC_ADC_T *adc, FunctionalState state) {
+}
+
+uint32_t sim_adc_rate() {
+    return adc_rate;
+}
+
+uint32_t sim_adc_sample(uint32_t n) {
+    unsigned channel = adc_regs.CR ? __builtin_ctz(adc_regs.CR & 0xff) : 0;
+    double t = (double)n / (adc_rate ? adc_rate : 1);
+    int value = ADC_SIGNAL_OFFSET + ADC_SIGNAL_AMPLITUDE * sin(2 * M_PI * ADC_SIGNAL_FREQ * channel * t);
+    return 1UL << 31 | channel << 24 | (value & 0x3ff) << 6;
+}
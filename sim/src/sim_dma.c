@@ -0,0 +1,81 @@
+#include <stdint.h>
+#include "sim.h"
+#include "dma.h"
+#include "task.h"
+
+/**
+ * Simulated GPDMA, implementing the dma interface. Only the transfers from ADC0 to
+ * memory are simulated: they complete, filled with the ADC test signal, after the time
+ * the ADC takes to convert all the samples.
+ */
+
+/** State of a channel. */
+typedef struct {
+    /** True if the channel is reserved. */
+    bool open;
+    dma_callback_t callback;
+    void *context;
+    /** True while a transfer is in progress. */
+    bool busy;
+    /** Destination of the transfer in progress. */
+    uint32_t *dst;
+    /** Amount of items of the transfer in progress. */
+    uint32_t count;
+    /** Time at which the transfer in progress completes (ns). */
+    uint64_t done_ns;
+} channel_t;
+
+static channel_t channels[GPDMA_NUMBER_CHANNELS];
+
+int dma_channel_open(dma_callback_t callback, void *context) {
+    for (int i = 0; i < GPDMA_NUMBER_CHANNELS; i++) {
+        if (!channels[i].open) {
+            channels[i] = (channel_t) {.open = true, .callback = callback, .context = context};
+            return i;
+        }
+    }
+    return -1;
+}
+
+void dma_channel_close(int channel) {
+    channels[channel] = (channel_t) {.open = false};
+}
+
+bool dma_start(int channel, uint32_t src, uint32_t dst, uint32_t type, uint32_t count) {
+    channel_t *c = &channels[channel];
+    uint32_t rate = sim_adc_rate();
+    if (type != GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA || src != GPDMA_CONN_ADC_0 || rate == 0) {
+        return false;
+    }
+    if (count == 0 || count > DMA_TRANSFER_MAX) {
+        return false;
+    }
+    taskENTER_CRITICAL();
+    // the address of a static buffer, which fits in 32 bits in a non-PIE executable
+    c->dst = (uint32_t *)(uintptr_t)dst;
+    c->count = count;
+    c->done_ns = sim_now_ns() + count * 1000000000ULL / rate;
+    c->busy = true;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void dma_stop(int channel) {
+    channels[channel].busy = false;
+}
+
+void sim_dma_step() {
+    uint64_t now = sim_now_ns();
+    for (int i = 0; i < GPDMA_NUMBER_CHANNELS; i++) {
+        channel_t *c = &channels[i];
+        if (!c->busy || now < c->done_ns) {
+            continue;
+        }
+        for (uint32_t n = 0; n < c->count; n++) {
+            c->dst[n] = sim_adc_sample(n);
+        }
+        c->busy = false;
+        BaseType_t woken = pdFALSE;
+        c->callback(i, true, c->context, &woken);
+    }
+}
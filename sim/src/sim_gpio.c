@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+ * Simulated GPIO pins and pin interrupts.
+ *
+ * Each pin has a level, changed by the firmware (gpioWrite) or by a script given with
+ * SIM_GPIO_SCRIPT. The script has one edge per line:
+ *
+ *     <time_ms> <pin> high|low|toggle [every <period_ms> [count <n>]]
+ *
+ * Eg: `500 TEC1 toggle every 10 count 100` toggles TEC1 100 times, every 10 ms, starting
+ * at 500 ms. Lines starting with `#` are ignored. The buttons (TEC1-4) start high, as
+ * they have pull-ups; every other pin starts low.
+ *
+ * Edges are latched in the pin interrupt registers as they happen; the interrupt of
+ * each enabled channel is then delivered on the next tick.
+ */
+
+/** Amount of pin interrupt channels. */
+#define PININT_CHANNELS 8
+/** Maximum amount of lines in the GPIO script. */
+#define SCRIPT_MAX 64
+
+/** Pin description. */
+typedef struct {
+    const char *name;
+    uint8_t port;
+    uint8_t pin;
+} sim_pin_t;
+
+#define SIM_PIN_DESC(name, port, pin) {#name, port, pin},
+
+static const sim_pin_t pins[SIM_PIN_COUNT] = {
+    SIM_PIN_LIST(SIM_PIN_DESC)
+};
+
+/** Pin levels. */
+static bool levels[SIM_PIN_COUNT];
+
+static LPC_PIN_INT_T pin_int_regs;
+LPC_PIN_INT_T *LPC_GPIO_PIN_INT = &pin_int_regs;
+
+static LPC_GPIO_T gpio_regs;
+LPC_GPIO_T *LPC_GPIO_PORT = &gpio_regs;
+
+/** Pin selected for each pin interrupt channel, or -1. */
+static int channel_pins[PININT_CHANNELS] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+/** Firmware ISR of each pin interrupt channel. */
+void GPIO0_IRQHandler();
+void GPIO1_IRQHandler();
+void GPIO2_IRQHandler();
+void GPIO3_IRQHandler();
+void GPIO4_IRQHandler();
+void GPIO5_IRQHandler();
+void GPIO6_IRQHandler();
+void GPIO7_IRQHandler();
+
+static void (*const handlers[PININT_CHANNELS])() = {
+    GPIO0_IRQHandler, GPIO1_IRQHandler, GPIO2_IRQHandler, GPIO3_IRQHandler,
+    GPIO4_IRQHandler, GPIO5_IRQHandler, GPIO6_IRQHandler, GPIO7_IRQHandler,
+};
+
+/** Action of a script line. */
+typedef enum { SCRIPT_LOW, SCRIPT_HIGH, SCRIPT_TOGGLE } script_action_t;
+
+/** A line of the GPIO script. */
+typedef struct {
+    gpioMap_t pin;
+    script_action_t action;
+    /** Time of the next application (ms). */
+    uint32_t next_ms;
+    /** Repetition period (ms), or 0. */
+    uint32_t period_ms;
+    /** Remaining applications, or 0 for unlimited (with a period). */
+    uint32_t count;
+    /** False once the line is done. */
+    bool active;
+} script_line_t;
+
+static script_line_t script[SCRIPT_MAX];
+static size_t script_lines;
+
+/** Find a pin by name. \return -1 if not found. */
+static int find_pin(const char *name) {
+    for (int i = 0; i < SIM_PIN_COUNT; i++) {
+        if (!strcmp(pins[i].name, name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Find a pin by GPIO port and pin. \return -1 if not found. */
+static int find_gpio(uint8_t port, uint8_t pin) {
+    for (int i = 0; i < SIM_PIN_COUNT; i++) {
+        if (pins[i].port == port && pins[i].pin == pin) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/** Parse a line of the GPIO script. \return false if invalid. */
+static bool parse_script_line(char *s, script_line_t *line) {
+    char *saveptr;
+    char *tokens[7];
+    int count = 0;
+    for (char *t = strtok_r(s, " \t\r\n", &saveptr); t && count < 7; t = strtok_r(NULL, " \t\r\n", &saveptr)) {
+        tokens[count++] = t;
+    }
+    if (count != 3 && count != 5 && count != 7) {
+        return false;
+    }
+    int pin = find_pin(tokens[1]);
+    if (pin < 0) {
+        return false;
+    }
+    *line = (script_line_t) {.pin = pin, .next_ms = atol(tokens[0]), .count = 1, .active = true};
+    if (!strcmp(tokens[2], "high")) {
+        line->action = SCRIPT_HIGH;
+    } else if (!strcmp(tokens[2], "low")) {
+        line->action = SCRIPT_LOW;
+    } else if (!strcmp(tokens[2], "toggle")) {
+        line->action = SCRIPT_TOGGLE;
+    } else {
+        return false;
+    }
+    if (count >= 5) {
+        line->period_ms = atol(tokens[4]);
+        line->count = 0;
+        if (strcmp(tokens[3], "every") || line->period_ms == 0) {
+            return false;
+        }
+    }
+    if (count == 7) {
+        line->count = atol(tokens[6]);
+        if (strcmp(tokens[5], "count") || line->count == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Load the GPIO script given in SIM_GPIO_SCRIPT, if any. */
+static void load_script() {
+    const char *path = getenv("SIM_GPIO_SCRIPT");
+    if (!path) {
+        return;
+    }
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    char s[128];
+    for (int n = 1; fgets(s, sizeof(s), f); n++) {
+        if (s[strspn(s, " \t")] == '#' || s[strspn(s, " \t\r\n")] == '\0') {
+            continue;
+        }
+        if (script_lines == SCRIPT_MAX || !parse_script_line(s, &script[script_lines])) {
+            fprintf(stderr, "%s:%d: invalid line\n", path, n);
+            exit(1);
+        }
+        script_lines++;
+    }
+    fclose(f);
+}
+
+void sim_gpio_init() {
+    levels[TEC1] = levels[TEC2] = levels[TEC3] = levels[TEC4] = true;
+    load_script();
+}
+
+void sim_gpio_set(gpioMap_t pin, bool level) {
+    taskENTER_CRITICAL();
+    if (levels[pin] != level) {
+        levels[pin] = level;
+        for (int ch = 0; ch < PININT_CHANNELS; ch++) {
+            uint32_t bit = PININTCH(ch);
+            if (channel_pins[ch] != (int)pin) {
+                continue;
+            }
+            if (level) {
+                pin_int_regs.RISE |= bit;
+            } else {
+                pin_int_regs.FALL |= bit;
+            }
+            if (!(pin_int_regs.ISEL & bit) && (level ? pin_int_regs.IENR : pin_int_regs.IENF) & bit) {
+                pin_int_regs.IST |= bit;
+            }
+        }
+    }
+    taskEXIT_CRITICAL();
+    sim_trace("%s %d", pins[pin].name, level);
+}
+
+/** Return true if the pin interrupt channel is requesting an interrupt. */
+static bool channel_pending(int ch) {
+    uint32_t bit = PININTCH(ch);
+    if (channel_pins[ch] < 0) {
+        return false;
+    }
+    if (pin_int_regs.ISEL & bit) {
+        bool active_high = pin_int_regs.IENF & bit;
+        return (pin_int_regs.IENR & bit) && levels[channel_pins[ch]] == active_high;
+    }
+    return pin_int_regs.IST & bit;
+}
+
+void sim_gpio_step() {
+    uint32_t now = sim_now_ms();
+    for (size_t i = 0; i < script_lines; i++) {
+        script_line_t *line = &script[i];
+        while (line->active && (int32_t)(now - line->next_ms) >= 0) {
+            bool level = line->action == SCRIPT_TOGGLE ? !levels[line->pin] : line->action == SCRIPT_HIGH;
+            sim_gpio_set(line->pin, level);
+            line->next_ms += line->period_ms;
+            if ((line->count && --line->count == 0) || !line->period_ms) {
+                line->active = false;
+            }
+        }
+    }
+
+    for (int ch = 0; ch < PININT_CHANNELS; ch++) {
+        if (sim_irq_enabled(PIN_INT0_IRQn + ch) && channel_pending(ch)) {
+            handlers[ch]();
+        }
+    }
+}
+
+bool_t gpioInit(gpioMap_t pin, gpioInit_t config) {
+    return pin < SIM_PIN_COUNT;
+}
+
+bool_t gpioRead(gpioMap_t pin) {
+    return levels[pin];
+}
+
+bool_t gpioWrite(gpioMap_t pin, bool_t value) {
+    sim_gpio_set(pin, value);
+    return TRUE;
+}
+
+bool_t gpioToggle(gpioMap_t pin) {
+    sim_gpio_set(pin, !levels[pin]);
+    return TRUE;
+}
+
+bool Chip_GPIO_GetPinState(LPC_GPIO_T *gpio, uint8_t port, uint8_t pin) {
+    int i = find_gpio(port, pin);
+    return i >= 0 && levels[i];
+}
+
+void Chip_SCU_GPIOIntPinSel(uint8_t PortSel, uint8_t PortNum, uint8_t PinNum) {
+    channel_pins[PortSel] = find_gpio(PortNum, PinNum);
+}
+
+void Chip_PININT_SetPinModeEdge(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->ISEL &= ~pins;
+}
+
+void Chip_PININT_SetPinModeLevel(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->ISEL |= pins;
+}
+
+void Chip_PININT_EnableIntHigh(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->IENR |= pins;
+}
+
+void Chip_PININT_DisableIntHigh(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->IENR &= ~pins;
+}
+
+void Chip_PININT_EnableIntLow(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->IENF |= pins;
+}
+
+void Chip_PININT_DisableIntLow(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->IENF &= ~pins;
+}
+
+void Chip_PININT_ClearIntStatus(LPC_PIN_INT_T *regs, uint32_t pins) {
+    // in level mode, writing IST toggles the active level
+    regs->IENF ^= pins & regs->ISEL;
+    pins &= ~regs->ISEL;
+    regs->IST &= ~pins;
+    regs->RISE &= ~pins;
+    regs->FALL &= ~pins;
+}
+
+uint32_t Chip_PININT_GetRiseStates(LPC_PIN_INT_T *regs) {
+    return regs->RISE;
+}
+
+uint32_t Chip_PININT_GetFallStates(LPC_PIN_INT_T *regs) {
+    return regs->FALL;
+}
+
+void Chip_PININT_ClearRiseStates(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->RISE &= ~pins;
+}
+
+void Chip_PININT_ClearFallStates(LPC_PIN_INT_T *regs, uint32_t pins) {
+    regs->FALL &= ~pins;
+}
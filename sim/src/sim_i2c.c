@@ -0,0 +1,173 @@
+#include <string.h>
+#include "sim.h"
+#include "i2c_engine.h"
+
+/**
+ * Simulated I2C bus, implementing the i2c_engine interface. Transactions complete on the
+ * tick after they start (or right after the RIT ISR that started them).
+ *
+ * Devices on the bus:
+ *
+ * - 0x48: temperature sensor (LM75 style). Register 0 holds the temperature, which
+ *   changes every second, as a big endian 16-bit value in 1/256 degrees.
+ * - 0x50: 256 byte EEPROM (24C02 style), initially erased (0xff).
+ *
+ * Each device has 256 registers. The first byte written sets the register pointer; the
+ * following ones are written from there on, and reads continue from there, incrementing
+ * the pointer.
+ */
+
+/** A simulated I2C device. */
+typedef struct sim_i2c_device {
+    /** 7-bit address. */
+    uint8_t address;
+    /** Registers. */
+    uint8_t regs[256];
+    /** Register pointer. */
+    uint8_t pointer;
+    /** Update the registers before a read, or NULL. */
+    void (*update)(struct sim_i2c_device *dev);
+} sim_i2c_device_t;
+
+/** Update the temperature register: 25.0 to 29.5 degrees, in 0.5 degree steps. */
+static void temperature_update(sim_i2c_device_t *dev) {
+    uint16_t t = (25 * 2 + sim_now_ms() / 1000 % 10) << 7;
+    dev->regs[0] = t >> 8;
+    dev->regs[1] = t & 0xff;
+}
+
+static sim_i2c_device_t devices[] = {
+    {.address = 0x48, .update = temperature_update},
+    {.address = 0x50},
+};
+
+/** Transaction in progress, or NULL. */
+static i2c_xfer_t *current;
+/** True if the last transaction did not end with a stop condition. */
+static bool bus_held;
+
+/** Find a device by address. \return NULL if no device acknowledges the address. */
+static sim_i2c_device_t *find_device(uint8_t address) {
+    for (size_t i = 0; i < sizeof(devices) / sizeof(devices[0]); i++) {
+        if (devices[i].address == address) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+/** Execute a transaction on the simulated devices. \return the final status. */
+static i2c_xfer_status_t execute(i2c_xfer_t *xfer) {
+    sim_i2c_device_t *dev = find_device(xfer->address);
+    if (dev == NULL) {
+        return I2C_XFER_NACK;
+    }
+    for (size_t i = 0; i < xfer->tx_nbytes; i++) {
+        if (i == 0) {
+            dev->pointer = xfer->tx_data[0];
+        } else {
+            dev->regs[dev->pointer++] = xfer->tx_data[i];
+        }
+    }
+    xfer->tx_index = xfer->tx_nbytes;
+    if (xfer->rx_nbytes > 0 && dev->update) {
+        dev->update(dev);
+    }
+    for (size_t i = 0; i < xfer->rx_nbytes; i++) {
+        xfer->rx_data[i] = dev->regs[dev->pointer++];
+    }
+    xfer->rx_index = xfer->rx_nbytes;
+    return I2C_XFER_DONE;
+}
+
+bool i2c_engine_init(uint32_t freq_hz) {
+    static bool initialized;
+    if (!initialized) {
+        memset(find_device(0x50)->regs, 0xff, sizeof(devices[0].regs));
+        initialized = true;
+    }
+    return freq_hz > 0;
+}
+
+bool i2c_engine_start(i2c_xfer_t *xfer) {
+    taskENTER_CRITICAL();
+    if (current != NULL) {
+        taskEXIT_CRITICAL();
+        return false;
+    }
+    xfer->status = I2C_XFER_BUSY;
+    xfer->tx_index = 0;
+    xfer->rx_index = 0;
+    current = xfer;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void sim_i2c_step() {
+    taskENTER_CRITICAL();
+    i2c_xfer_t *xfer = current;
+    current = NULL;
+    taskEXIT_CRITICAL();
+    if (xfer == NULL) {
+        return;
+    }
+
+    xfer->status = execute(xfer);
+    // errors release the bus; otherwise, it is held until a transaction ends with a stop
+    bus_held = xfer->status == I2C_XFER_DONE && !(xfer->rx_nbytes > 0 ? xfer->rx_stop : xfer->tx_stop);
+    sim_trace("i2c %02x tx %u rx %u: %d", xfer->address,
+        (unsigned)xfer->tx_nbytes, (unsigned)xfer->rx_nbytes, xfer->status);
+
+    BaseType_t woken = pdFALSE;
+    if (xfer->on_done) {
+        xfer->on_done(xfer, &woken);
+    } else {
+        vTaskNotifyGiveFromISR(xfer->task, &woken);
+    }
+}
+
+i2c_xfer_status_t i2c_engine_transfer(i2c_xfer_t *xfer, TickType_t timeout) {
+    xfer->on_done = NULL;
+    xfer->task = xTaskGetCurrentTaskHandle();
+
+    // discard stale notifications
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    // the engine may be busy with a transaction started from an ISR (eg: `i2c stream`)
+    TickType_t start = xTaskGetTickCount();
+    while (!i2c_engine_start(xfer)) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return I2C_XFER_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+
+    while (xfer->status == I2C_XFER_BUSY) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            taskENTER_CRITICAL();
+            if (current == xfer) {
+                current = NULL;
+                xfer->status = I2C_XFER_TIMEOUT;
+            }
+            taskEXIT_CRITICAL();
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+    return xfer->status;
+}
+
+void i2c_engine_abort() {
+    taskENTER_CRITICAL();
+    if (current != NULL) {
+        current->status = I2C_XFER_ERROR;
+        current = NULL;
+    }
+    bus_held = false;
+    taskEXIT_CRITICAL();
+}
+
+bool i2c_engine_bus_held() {
+    return bus_held;
+}
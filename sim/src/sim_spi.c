@@ -0,0 +1,48 @@
+#include <string.h>
+#include "sim.h"
+#include "spi_engine.h"
+#include "task.h"
+
+/**
+ * Simulated SPI master, implementing the spi_engine interface, with MISO wired to MOSI:
+ * each byte received is the byte sent. The calling task is blocked for the duration of
+ * the transfer at the configured clock.
+ */
+
+/** Highest SPI clock of the LPC4337 SSP (Hz). */
+#define SPI_FREQ_MAX (SIM_CORE_CLOCK / 2)
+
+/** Configured clock frequency (Hz), or 0 if not initialized. */
+static uint32_t freq;
+
+bool spi_engine_init(uint32_t freq_hz, uint8_t mode) {
+    if (freq_hz == 0 || mode > 3) {
+        return false;
+    }
+    freq = freq_hz < SPI_FREQ_MAX ? freq_hz : SPI_FREQ_MAX;
+    return true;
+}
+
+uint32_t spi_engine_max_freq() {
+    return SPI_FREQ_MAX;
+}
+
+uint32_t spi_engine_freq() {
+    return freq;
+}
+
+spi_xfer_status_t spi_engine_transfer(const uint8_t *tx_data, uint8_t *rx_data, size_t nbytes, TickType_t timeout) {
+    if (freq == 0) {
+        return SPI_XFER_ERROR;
+    }
+    TickType_t ticks = nbytes * 8ULL * configTICK_RATE_HZ / freq;
+    if (ticks > timeout) {
+        vTaskDelay(timeout);
+        return SPI_XFER_TIMEOUT;
+    }
+    if (ticks > 0) {
+        vTaskDelay(ticks);
+    }
+    memmove(rx_data, tx_data, nbytes);
+    return SPI_XFER_DONE;
+}
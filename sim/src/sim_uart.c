@@ -0,0 +1,187 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "sim.h"
+#include "FreeRTOS.h"
+
+/**
+ * Simulated UART: reads from stdin (or a pseudo-terminal) and writes to stdout, at the
+ * configured baud rate. Received bytes are handed to the firmware receive callback one
+ * at a time, from the sim task, as the UART ISR would.
+ */
+
+/** Bits per byte on the line (start + 8 data + stop). */
+#define UART_FRAME_BITS 10
+/** Receive FIFO of the UART: bytes that can accumulate while no input arrives. */
+#define UART_RX_FIFO 16
+/** Maximum bytes received per tick when the speed is unlimited. */
+#define UART_RX_UNLIMITED 256
+
+static int in_fd = STDIN_FILENO;
+static int out_fd = STDOUT_FILENO;
+/** True if the UART is a pseudo-terminal, which has no end of input. */
+static bool pty;
+
+/** Line speed (bits/s), or 0 for unlimited. */
+static uint32_t baud;
+/** True if SIM_BAUD overrides the speed configured by the firmware. */
+static bool baud_fixed;
+
+static callBackFuncPtr_t rx_callback;
+static void *rx_callback_param;
+static bool rx_interrupt;
+/** Last byte received, returned by uartRxRead. */
+static uint8_t rx_data;
+/** Receive budget, in bits. */
+static uint32_t rx_credit;
+
+/** Time at which the transmitter is free again (ns). */
+static uint64_t tx_free_ns;
+
+/** Time at which the end of input was reached (ms), or 0. */
+static uint32_t eof_ms;
+/** Time to keep running after the end of input (ms). */
+static uint32_t linger_ms;
+
+static unsigned long rx_total;
+static unsigned long tx_total;
+
+/** Open a pseudo-terminal for the UART, and print its name. */
+static void open_pty() {
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+        perror("sim: pty");
+        exit(1);
+    }
+    struct termios tio;
+    tcgetattr(fd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(fd, TCSANOW, &tio);
+    fprintf(stderr, "sim: UART on %s\n", ptsname(fd));
+    in_fd = out_fd = fd;
+    pty = true;
+}
+
+void sim_uart_init() {
+    if (sim_env("SIM_PTY", 0)) {
+        open_pty();
+    }
+    long b = sim_env("SIM_BAUD", -1);
+    if (b >= 0) {
+        baud = b;
+        baud_fixed = true;
+    }
+    linger_ms = sim_env("SIM_LINGER_MS", 1000);
+}
+
+void sim_uart_summary() {
+    fprintf(stderr, "sim: %lu ms, UART rx %lu bytes, tx %lu bytes\n",
+        (unsigned long)sim_now_ms(), rx_total, tx_total);
+}
+
+void uartConfig(uartMap_t uart, uint32_t baudRate) {
+    if (!baud_fixed) {
+        baud = baudRate;
+    }
+}
+
+void uartCallbackSet(uartMap_t uart, uartEvents_t event, callBackFuncPtr_t callback, void *param) {
+    if (event == UART_RECEIVE) {
+        rx_callback = callback;
+        rx_callback_param = param;
+    }
+}
+
+void uartInterrupt(uartMap_t uart, bool_t enable) {
+    rx_interrupt = enable;
+}
+
+uint8_t uartRxRead(uartMap_t uart) {
+    return rx_data;
+}
+
+/** Write the whole buffer, retrying if interrupted by the tick signal. */
+static void write_all(const uint8_t *data, size_t nbytes) {
+    while (nbytes > 0) {
+        ssize_t n = write(out_fd, data, nbytes);
+        if (n < 0 && errno != EINTR) {
+            return;
+        }
+        if (n > 0) {
+            data += n;
+            nbytes -= n;
+        }
+    }
+}
+
+/** Busy wait until the given time, like the firmware waiting for the UART FIFO. */
+static void wait_until(uint64_t t_ns) {
+    uint64_t now;
+    while ((now = sim_now_ns()) < t_ns) {
+        struct timespec ts = {.tv_sec = 0, .tv_nsec = t_ns - now};
+        nanosleep(&ts, NULL);
+    }
+}
+
+void uartWriteByte(uartMap_t uart, uint8_t value) {
+    if (baud) {
+        wait_until(tx_free_ns);
+        uint64_t now = sim_now_ns();
+        tx_free_ns = (tx_free_ns > now ? tx_free_ns : now) + UART_FRAME_BITS * 1000000000ULL / baud;
+    }
+    write_all(&value, 1);
+    tx_total++;
+}
+
+void sim_uart_step() {
+    if (eof_ms) {
+        if (sim_now_ms() - eof_ms >= linger_ms) {
+            sim_uart_summary();
+            exit(0);
+        }
+        return;
+    }
+
+    size_t max = UART_RX_UNLIMITED;
+    if (baud) {
+        rx_credit += baud / configTICK_RATE_HZ;
+        max = rx_credit / UART_FRAME_BITS;
+    }
+    if (max == 0) {
+        return;
+    }
+
+    struct pollfd pfd = {.fd = in_fd, .events = POLLIN};
+    if (poll(&pfd, 1, 0) <= 0) {
+        // the line is idle: only the FIFO can fill up meanwhile
+        if (rx_credit > UART_RX_FIFO * UART_FRAME_BITS) {
+            rx_credit = UART_RX_FIFO * UART_FRAME_BITS;
+        }
+        return;
+    }
+
+    uint8_t buf[UART_RX_UNLIMITED];
+    ssize_t n = read(in_fd, buf, max < sizeof(buf) ? max : sizeof(buf));
+    if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN && !pty)) {
+        eof_ms = sim_now_ms() ? sim_now_ms() : 1;
+        return;
+    }
+    if (n < 0) {
+        return;
+    }
+    if (baud) {
+        rx_credit -= n * UART_FRAME_BITS;
+    }
+    rx_total += n;
+    for (ssize_t i = 0; i < n; i++) {
+        rx_data = buf[i];
+        if (rx_interrupt && rx_callback) {
+            rx_callback(rx_callback_param);
+        }
+    }
+}
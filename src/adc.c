@@ -0,0 +1,317 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "adc.h"
+#include "dma.h"
+#include "terminal.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Maximum amount of samples in a capture */
+#define ADC_CAPTURE_MAX 2048
+/** Maximum sample rate (Hz) of the ADC at 10 bits */
+#define ADC_RATE_MAX 400000
+/** ADC clock cycles per 10-bit conversion */
+#define ADC_CLOCKS_PER_SAMPLE 11
+/** Largest divider from the peripheral clock to the ADC clock (CR.CLKDIV is 8 bits wide) */
+#define ADC_CLKDIV_MAX 256
+/** Highest ADC0 channel wired to the board connectors (CH1 to CH3) */
+#define ADC_CHANNEL_MAX 3
+/** Extra time allowed for a capture, on top of its nominal duration (ms) */
+#define ADC_TIMEOUT_MARGIN_MS 100
+/** Samples printed per line in text format */
+#define ADC_SAMPLES_PER_LINE 16
+
+// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
+#define str(a) #a
+#define xstr(a) str(a)
+
+/** Print the `adc` command usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage: adc <command> ...\r\n"
+        "\r\n"
+        "Commands:\r\n"
+        "\r\n"
+        "  help\r\n"
+        "\r\n"
+        "  capture <channel> <rate_hz> <nsamples> [decimate <n>] [stats|bin]\r\n"
+        "      Capture <nsamples> (up to " xstr(ADC_CAPTURE_MAX) ") from ADC0 channel 1-3 at <rate_hz>\r\n"
+        "      (up to " xstr(ADC_RATE_MAX) ") into RAM by DMA, and then print them. The lowest\r\n"
+        "      rate is limited by the ADC clock divider (about 72 kHz at 204 MHz).\r\n"
+        "      `decimate <n>` replaces each group of <n> samples by its average.\r\n"
+        "      `stats` prints min, max, mean and RMS instead of the samples.\r\n"
+        "      `bin` prints `ADC <nsamples> 2` followed by the samples as little endian uint16.\r\n"
+        "      Eg: adc capture 1 100000 2048 stats\r\n"
+        "          adc capture 2 200000 2000 decimate 10\r\n"
+    );
+}
+
+/**
+ * Capture buffer. The DMA copies the whole ADC global data register for each sample; the
+ * results are then packed in place as uint16.
+ */
+static uint32_t samples[ADC_CAPTURE_MAX];
+
+/** True while a capture is using the ADC and the buffer. */
+static bool busy;
+
+/** DMA channel used for captures, or -1 if not reserved yet. */
+static int dma_channel = -1;
+
+/** Task waiting for the capture in progress. */
+static TaskHandle_t waiting;
+
+/** Set by the DMA ISR if the channel reported an error. */
+static volatile bool dma_error;
+
+/** DMA channel completion callback. Called from the DMA ISR. */
+static void capture_done(uint8_t channel, bool ok, void *context, BaseType_t *woken) {
+    if (!ok) {
+        dma_error = true;
+    }
+    vTaskNotifyGiveFromISR(waiting, woken);
+}
+
+/**
+ * Return the lowest sample rate (Hz) that the ADC clock divider can reach. Below it, the
+ * divider would be truncated to 8 bits and the ADC would run faster than requested.
+ */
+static uint32_t rate_min() {
+    uint32_t div = ADC_CLOCKS_PER_SAMPLE * ADC_CLKDIV_MAX;
+    return (Chip_Clock_GetRate(CLK_APB3_ADC0) + div - 1) / div;
+}
+
+/**
+ * Capture nsamples samples from an ADC0 channel in burst mode, blocking the calling task
+ * until the DMA fills the buffer. The results are packed as uint16 in the buffer.
+ *
+ * \return false if the capture failed.
+ */
+static bool capture(uint8_t channel, uint32_t rate_hz, size_t nsamples) {
+    if (dma_channel < 0) {
+        dma_channel = dma_channel_open(capture_done, NULL);
+        if (dma_channel < 0) {
+            log_error("No DMA channels available");
+            return false;
+        }
+    }
+
+    ADC_CLOCK_SETUP_T setup;
+    Chip_ADC_Init(LPC_ADC0, &setup);
+    Chip_ADC_SetSampleRate(LPC_ADC0, &setup, rate_hz);
+    Chip_ADC_EnableChannel(LPC_ADC0, channel, ENABLE);
+    // the end of conversion flag of the channel is the DMA request
+    Chip_ADC_Int_SetChannelCmd(LPC_ADC0, channel, ENABLE);
+
+    waiting = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    dma_error = false;
+
+    bool ok = dma_start(dma_channel, GPDMA_CONN_ADC_0, (uint32_t)(uintptr_t)samples, GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA, nsamples);
+    if (ok) {
+        Chip_ADC_SetBurstCmd(LPC_ADC0, ENABLE);
+        TickType_t timeout = pdMS_TO_TICKS(nsamples * 1000ULL / rate_hz + ADC_TIMEOUT_MARGIN_MS);
+        ok = ulTaskNotifyTake(pdTRUE, timeout) && !dma_error;
+        Chip_ADC_SetBurstCmd(LPC_ADC0, DISABLE);
+    }
+    dma_stop(dma_channel);
+    Chip_ADC_Int_SetChannelCmd(LPC_ADC0, channel, DISABLE);
+    Chip_ADC_EnableChannel(LPC_ADC0, channel, DISABLE);
+
+    if (!ok) {
+        log_error("ADC capture failed");
+        return false;
+    }
+
+    // pack the 10-bit results; each uint16 slot is at or before the word it comes from
+    uint16_t *packed = (uint16_t *)samples;
+    for (size_t i = 0; i < nsamples; i++) {
+        packed[i] = ADC_DR_RESULT(samples[i]);
+    }
+    return true;
+}
+
+/** Replace each group of n samples by its average. \return the new amount of samples. */
+static size_t decimate(uint16_t data[], size_t nsamples, size_t n) {
+    size_t out = 0;
+    for (size_t i = 0; i + n <= nsamples; i += n) {
+        uint32_t sum = 0;
+        for (size_t j = 0; j < n; j++) {
+            sum += data[i + j];
+        }
+        data[out++] = (sum + n / 2) / n;
+    }
+    return out;
+}
+
+/** Integer square root. */
+static uint32_t isqrt(uint64_t x) {
+    uint64_t r = 0;
+    uint64_t bit = 1ULL << 62;
+    while (bit > x) {
+        bit >>= 2;
+    }
+    while (bit) {
+        if (x >= r + bit) {
+            x -= r + bit;
+            r = (r >> 1) + bit;
+        } else {
+            r >>= 1;
+        }
+        bit >>= 2;
+    }
+    return r;
+}
+
+/** Print a value with two decimals, given as hundredths. */
+static void print_hundredths(const char *name, uint32_t x100) {
+    char s[32];
+    snprintf(s, sizeof(s), "%s: %lu.%02lu", name, (unsigned long)(x100 / 100), (unsigned long)(x100 % 100));
+    terminal_println(s);
+}
+
+/** Print min, max, mean and RMS of the samples, in ADC counts. */
+static void print_stats(const uint16_t data[], size_t nsamples) {
+    uint16_t min = data[0];
+    uint16_t max = data[0];
+    uint32_t sum = 0;
+    uint64_t sum_squares = 0;
+    for (size_t i = 0; i < nsamples; i++) {
+        if (data[i] < min) {
+            min = data[i];
+        }
+        if (data[i] > max) {
+            max = data[i];
+        }
+        sum += data[i];
+        sum_squares += (uint32_t)data[i] * data[i];
+    }
+
+    char s[32];
+    snprintf(s, sizeof(s), "Samples: %lu", (unsigned long)nsamples);
+    terminal_println(s);
+    snprintf(s, sizeof(s), "Min: %u", min);
+    terminal_println(s);
+    snprintf(s, sizeof(s), "Max: %u", max);
+    terminal_println(s);
+    print_hundredths("Mean", sum * 100ULL / nsamples);
+    print_hundredths("RMS", isqrt(sum_squares * 10000ULL / nsamples));
+}
+
+/** Print the samples in text format. */
+static void print_samples(const uint16_t data[], size_t nsamples) {
+    char s[8];
+    for (size_t i = 0; i < nsamples; i++) {
+        bool eol = i % ADC_SAMPLES_PER_LINE == ADC_SAMPLES_PER_LINE - 1 || i == nsamples - 1;
+        snprintf(s, sizeof(s), eol ? "%u\r\n" : "%u ", data[i]);
+        terminal_puts(s);
+    }
+}
+
+/** Print the samples in binary format. */
+static void write_samples(const uint16_t data[], size_t nsamples) {
+    char s[32];
+    snprintf(s, sizeof(s), "ADC %lu %u", (unsigned long)nsamples, (unsigned)sizeof(uint16_t));
+    terminal_println(s);
+    for (size_t i = 0; i < nsamples; i++) {
+        uint8_t le[] = {data[i] & 0xff, data[i] >> 8};
+        terminal_write(le, sizeof(le));
+    }
+}
+
+/** Output format of `adc capture`. */
+typedef enum {
+    ADC_OUTPUT_TEXT,
+    ADC_OUTPUT_STATS,
+    ADC_OUTPUT_BIN,
+} adc_output_t;
+
+/** `adc capture ...` command handler. */
+static void adc_capture(const cmd_args_t *args) {
+    cli_assert(args->count >= 5, usage);
+    int channel = atoi(args->tokens[2]);
+    int rate_hz = atoi(args->tokens[3]);
+    int nsamples = atoi(args->tokens[4]);
+    cli_assert(channel >= 1 && channel <= ADC_CHANNEL_MAX, usage);
+    cli_assert(rate_hz > 0 && rate_hz <= ADC_RATE_MAX, usage);
+    cli_assert(nsamples > 0 && nsamples <= ADC_CAPTURE_MAX, usage);
+    if (rate_hz < rate_min()) {
+        char s[48];
+        snprintf(s, sizeof(s), "Error: The minimum sample rate is %lu Hz", (unsigned long)rate_min());
+        terminal_println(s);
+        return;
+    }
+
+    int decimation = 1;
+    adc_output_t output = ADC_OUTPUT_TEXT;
+    for (int i = 5; i < args->count; i++) {
+        if (!strcmp(args->tokens[i], "decimate") && i + 1 < args->count) {
+            decimation = atoi(args->tokens[++i]);
+            cli_assert(decimation > 0 && decimation <= nsamples, usage);
+        } else if (!strcmp(args->tokens[i], "stats")) {
+            output = ADC_OUTPUT_STATS;
+        } else if (!strcmp(args->tokens[i], "bin")) {
+            output = ADC_OUTPUT_BIN;
+        } else {
+            cli_assert(false, usage);
+        }
+    }
+
+    // background output would corrupt the binary samples
+    if (output == ADC_OUTPUT_BIN && !terminal_begin_binary()) {
+        return;
+    }
+
+    taskENTER_CRITICAL();
+    bool was_busy = busy;
+    busy = true;
+    taskEXIT_CRITICAL();
+    if (was_busy) {
+        log_error("ADC busy");
+        if (output == ADC_OUTPUT_BIN) {
+            terminal_end_binary();
+        }
+        return;
+    }
+
+    if (capture(channel, rate_hz, nsamples)) {
+        uint16_t *data = (uint16_t *)samples;
+        size_t count = decimation > 1 ? decimate(data, nsamples, decimation) : nsamples;
+        switch (output) {
+        case ADC_OUTPUT_STATS:
+            print_stats(data, count);
+            break;
+        case ADC_OUTPUT_BIN:
+            write_samples(data, count);
+            break;
+        default:
+            print_samples(data, count);
+            break;
+        }
+    }
+
+    busy = false;
+    if (output == ADC_OUTPUT_BIN) {
+        terminal_end_binary();
+    }
+}
+
+/** `adc` command handler function. */
+static void adc_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count >= 2, usage);
+    if (!strcmp(args->tokens[1], "help")) {
+        usage();
+    } else if (!strcmp(args->tokens[1], "capture")) {
+        adc_capture(args);
+    } else {
+        cli_assert(false, usage);
+    }
+}
+
+const cmd_t adc_command = {
+    .name = "adc",
+    .description = "Capture analog samples",
+    .handler = adc_cmd_handler,
+};
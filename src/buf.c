@@ -0,0 +1,180 @@
+#include <stdio.h>
+#include <string.h>
+#include "buf.h"
+#include "ringbuf.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "semphr.h"
+
+/** Amount of buffers */
+#define BUF_COUNT 4
+/** Size of each buffer (bytes). Must be a power of 2. */
+#define BUF_SIZE 2048
+/** Amount of bytes copied at a time by `buf dump` */
+#define BUF_DUMP_CHUNK 32
+
+/** Print the `buf` command usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage: buf <command> ...\r\n"
+        "\r\n"
+        "Commands:\r\n"
+        "\r\n"
+        "  dump <name>\r\n"
+        "      Print and drain the contents of the buffer.\r\n"
+        "\r\n"
+        "  clear <name>\r\n"
+        "      Discard the contents of the buffer.\r\n"
+        "\r\n"
+        "  stat\r\n"
+        "      Show the usage of all buffers, and the amount of output dropped because\r\n"
+        "      they were full.\r\n"
+        "\r\n"
+        "Buffers are named buf0 to buf3. Redirect the output of any command to a buffer\r\n"
+        "by appending `> <name>`; commands spawned by `loop` and `irq` inherit it.\r\n"
+        "  Eg: loop start 5 gpio TEC1 read > buf0\r\n"
+        "      buf dump buf0\r\n"
+    );
+}
+
+/** A named output buffer. */
+typedef struct {
+    /** Output sink. Must be the first member. */
+    terminal_sink_t sink;
+    /** Buffer name. */
+    const char *name;
+    /** Buffered output. */
+    ringbuf_t rb;
+    /** Storage for the buffered output. */
+    uint8_t storage[BUF_SIZE];
+    /** Total amount of bytes written. */
+    uint32_t written;
+    /** Bytes dropped because the buffer was full. */
+    uint32_t dropped;
+    /** Serializes the writers, and the readers. */
+    SemaphoreHandle_t mutex;
+} buf_t;
+
+static void buf_write(terminal_sink_t *sink, const void *data, size_t nbytes);
+
+#define MAKE_BUF(n) {.sink = {.write = buf_write}, .name = "buf" #n}
+
+static buf_t bufs[BUF_COUNT] = {
+    MAKE_BUF(0),
+    MAKE_BUF(1),
+    MAKE_BUF(2),
+    MAKE_BUF(3),
+};
+
+bool buf_init() {
+    for (int i = 0; i < BUF_COUNT; i++) {
+        ringbuf_init(&bufs[i].rb, bufs[i].storage, BUF_SIZE);
+        bufs[i].mutex = xSemaphoreCreateMutex();
+        if (bufs[i].mutex == NULL) {
+            log_error("Failed to create mutex");
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Output sink write function. Several tasks may write to the same buffer, so writes are
+ * serialized by the buffer mutex (the copy may be up to BUF_SIZE bytes, too long for a
+ * critical section). A write that does not fit is dropped whole, so it is never cut;
+ * but a line written in several writes (eg: by terminal_println) may lose its end.
+ */
+static void buf_write(terminal_sink_t *sink, const void *data, size_t nbytes) {
+    buf_t *buf = (buf_t *)sink;
+    xSemaphoreTake(buf->mutex, portMAX_DELAY);
+    if (ringbuf_put(&buf->rb, data, nbytes)) {
+        buf->written += nbytes;
+    } else {
+        buf->dropped += nbytes;
+    }
+    xSemaphoreGive(buf->mutex);
+}
+
+/** Find a buffer by name. \return NULL if not found. */
+static buf_t *find_buf(const char *name) {
+    for (int i = 0; i < BUF_COUNT; i++) {
+        if (!strcmp(bufs[i].name, name)) {
+            return &bufs[i];
+        }
+    }
+    return NULL;
+}
+
+terminal_sink_t *buf_find_sink(const char *name) {
+    buf_t *buf = find_buf(name);
+    return buf ? &buf->sink : NULL;
+}
+
+/** `buf dump <name>` command handler. */
+static void buf_dump(buf_t *buf) {
+    // only the data present now, in case the output of this command goes to the same buffer
+    size_t remaining = ringbuf_used(&buf->rb);
+    uint8_t chunk[BUF_DUMP_CHUNK];
+    while (remaining > 0) {
+        // not held while writing the chunk, which may go to this same buffer
+        xSemaphoreTake(buf->mutex, portMAX_DELAY);
+        size_t nbytes = ringbuf_get(&buf->rb, chunk, remaining < sizeof(chunk) ? remaining : sizeof(chunk));
+        xSemaphoreGive(buf->mutex);
+        if (nbytes == 0) {
+            break;
+        }
+        terminal_write(chunk, nbytes);
+        remaining -= nbytes;
+    }
+}
+
+/** `buf clear <name>` command handler. */
+static void buf_clear(buf_t *buf) {
+    xSemaphoreTake(buf->mutex, portMAX_DELAY);
+    ringbuf_clear(&buf->rb);
+    buf->written = 0;
+    buf->dropped = 0;
+    xSemaphoreGive(buf->mutex);
+}
+
+/** `buf stat` command handler. */
+static void buf_stat() {
+    terminal_println("name   used/size   written   dropped");
+    char s[48];
+    for (int i = 0; i < BUF_COUNT; i++) {
+        buf_t *buf = &bufs[i];
+        xSemaphoreTake(buf->mutex, portMAX_DELAY);
+        size_t used = ringbuf_used(&buf->rb);
+        uint32_t written = buf->written;
+        uint32_t dropped = buf->dropped;
+        xSemaphoreGive(buf->mutex);
+        snprintf(s, sizeof(s), "%-6s %4lu/%-4u %9lu %9lu", buf->name,
+            (unsigned long)used, BUF_SIZE, (unsigned long)written, (unsigned long)dropped);
+        terminal_println(s);
+    }
+}
+
+/** `buf` command handler function. */
+static void buf_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count >= 2, usage);
+    if (args->count == 2 && !strcmp(args->tokens[1], "stat")) {
+        buf_stat();
+        return;
+    }
+    cli_assert(args->count == 3, usage);
+    buf_t *buf = find_buf(args->tokens[2]);
+    cli_assert(buf != NULL, usage);
+    if (!strcmp(args->tokens[1], "dump")) {
+        buf_dump(buf);
+    } else if (!strcmp(args->tokens[1], "clear")) {
+        buf_clear(buf);
+    } else {
+        cli_assert(false, usage);
+    }
+}
+
+const cmd_t buf_command = {
+    .name = "buf",
+    .description = "Show or clear output buffers",
+    .handler = buf_cmd_handler,
+};
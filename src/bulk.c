@@ -0,0 +1,175 @@
+#include <stdio.h>
+#include <string.h>
+#include "bulk.h"
+#include "lookup.h"
+#include "lzss.h"
+#include "terminal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** CRC-32 (IEEE 802.3, reflected) polynomial. */
+#define CRC32_POLY 0xedb88320UL
+
+// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
+#define str(a) #a
+#define xstr(a) str(a)
+
+/** Print the `bulk` command usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage: bulk <command...>\r\n"
+        "      Execute the command, sending its output compressed with LZSS in binary\r\n"
+        "      frames: `BULK " xstr(LZSS_WINDOW_BITS) " " xstr(LZSS_LENGTH_BITS) "` (window and length bits), then frames of\r\n"
+        "      <n> (1 byte) and <n> compressed bytes, and finally a 0 followed by the size\r\n"
+        "      and the CRC-32 of the output, as little endian uint32. Background output\r\n"
+        "      is held until the command finishes. Decode it with tools/bulkdecode.py.\r\n"
+        "      Commands that start tasks (`loop`, `watch`, `irq`, `&`) are not allowed.\r\n"
+        "      Eg: bulk buf dump buf0\r\n"
+        "          bulk adc capture 1 100000 2048 bin\r\n"
+    );
+}
+
+/** Output sink that compresses the output of the command. */
+typedef struct {
+    /** Output sink. Must be the first member. */
+    terminal_sink_t sink;
+    /** Sink that receives the frames. */
+    terminal_sink_t *output;
+    /** Compressor state. */
+    lzss_encoder_t encoder;
+    /** Amount of uncompressed bytes. */
+    uint32_t nbytes;
+    /** CRC-32 of the uncompressed bytes, before the final inversion. */
+    uint32_t crc;
+    /** Task executing `bulk`; output of any other task is discarded. */
+    TaskHandle_t task;
+} bulk_t;
+
+/**
+ * Commands that start tasks inheriting the output sink (see `terminal_get_sink`), which
+ * would keep writing to the sink of `bulk` after it returns.
+ */
+static const char *const spawning_commands[] = {"irq", "loop", "watch"};
+
+/** The compressor needs a few hundred bytes, so there is a single one. */
+static bulk_t bulk;
+
+/** True while a command is using `bulk`. */
+static bool busy;
+
+/** Update a CRC-32 with nbytes bytes (bitwise: the UART is much slower anyway). */
+static uint32_t crc32_update(uint32_t crc, const uint8_t data[], size_t nbytes) {
+    for (size_t i = 0; i < nbytes; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32_POLY : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+/** Write to the sink that receives the frames, instead of compressing. */
+static void write_output(bulk_t *b, const void *data, size_t nbytes) {
+    terminal_set_sink(b->output);
+    terminal_write(data, nbytes);
+    terminal_set_sink(&b->sink);
+}
+
+/** Compressor output function: send a frame. */
+static void write_frame(void *context, const uint8_t data[], size_t nbytes) {
+    uint8_t n = nbytes;
+    write_output(context, &n, 1);
+    write_output(context, data, nbytes);
+}
+
+/** Sink write function: compress the output of the command. */
+static void bulk_write(terminal_sink_t *sink, const void *data, size_t nbytes) {
+    bulk_t *b = (bulk_t *)sink;
+    if (xTaskGetCurrentTaskHandle() != b->task) {
+        // a task that inherited the sink anyway: its output would corrupt the frames
+        return;
+    }
+    b->nbytes += nbytes;
+    b->crc = crc32_update(b->crc, data, nbytes);
+    lzss_feed(&b->encoder, data, nbytes);
+}
+
+/** Write a uint32 in little endian. */
+static void write_u32(bulk_t *b, uint32_t x) {
+    uint8_t le[] = {x & 0xff, (x >> 8) & 0xff, (x >> 16) & 0xff, x >> 24};
+    write_output(b, le, sizeof(le));
+}
+
+/** Return true if the command starts a task or a job. */
+static bool spawns_task(const cmd_args_t *args) {
+    if (!strcmp(args->tokens[args->count - 1], "&")) {
+        return true;
+    }
+    for (size_t i = 0; i < ARRAY_SIZE(spawning_commands); i++) {
+        if (!strcmp(args->tokens[1], spawning_commands[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/** `bulk` command handler function. */
+static void bulk_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count >= 2, usage);
+    if (args->count == 2 && !strcmp(args->tokens[1], "help")) {
+        usage();
+        return;
+    }
+    cli_assert(!spawns_task(args), usage);
+
+    taskENTER_CRITICAL();
+    bool was_busy = busy;
+    busy = true;
+    taskEXIT_CRITICAL();
+    if (was_busy) {
+        log_error("bulk busy");
+        return;
+    }
+
+    // background output would corrupt the frames
+    if (!terminal_begin_binary()) {
+        busy = false;
+        return;
+    }
+    cmd_args_t *subcmd = cli_args_alloc();
+    if (subcmd == NULL) {
+        log_error("Out of command buffers; see `pool`");
+        terminal_end_binary();
+        busy = false;
+        return;
+    }
+    cli_extract_subcommand(args, 1, subcmd);
+
+    terminal_println("BULK " xstr(LZSS_WINDOW_BITS) " " xstr(LZSS_LENGTH_BITS));
+
+    bulk.sink.write = bulk_write;
+    bulk.output = terminal_set_sink(&bulk.sink);
+    bulk.nbytes = 0;
+    bulk.crc = 0xffffffffUL;
+    bulk.task = xTaskGetCurrentTaskHandle();
+    lzss_init(&bulk.encoder, write_frame, &bulk);
+
+    cli_exec_command(subcmd);
+
+    lzss_finish(&bulk.encoder);
+    uint8_t end = 0;
+    write_output(&bulk, &end, 1);
+    write_u32(&bulk, bulk.nbytes);
+    write_u32(&bulk, ~bulk.crc);
+    terminal_set_sink(bulk.output);
+    terminal_end_binary();
+
+    cli_args_free(subcmd);
+    busy = false;
+}
+
+const cmd_t bulk_command = {
+    .name = "bulk",
+    .description = "Execute a command, compressing its output",
+    .handler = bulk_cmd_handler,
+};
@@ -5,16 +5,34 @@
 #include "FreeRTOS.h"
 #include "task.h"
 #include "terminal.h"
+#include "pool.h"
+#include "tokenizer.h"
+#include "buf.h"
+#include "jobs.h"
+#include "gpio.h"
+#include "irq.h"
 #include "task_priorities.h"
 
+/** Amount of command line buffers, shared by the other tasks that parse commands. */
+#define CLI_ARGS_BUFFERS 4
+
+/** Command line buffers. */
+POOL_DEFINE(args_pool, "cli args", sizeof(cmd_args_t), CLI_ARGS_BUFFERS);
+
+/** Command line buffer of the CLI task, which must never wait for the pool. */
+static cmd_args_t cli_args;
+
+/** The CLI task, the only one that reads commands and data from the terminal. */
+static TaskHandle_t cli_task_handle;
+
 /** Show the list of available commands and their descriptions. */
 static void print_help() {
     terminal_println("Available commands:");
-    for (const cmd_t **cmd = commands; *cmd; cmd++) {
+    for (size_t i = 0; i < commands_count; i++) {
         terminal_puts("  ");
-        terminal_puts((*cmd)->name);
+        terminal_puts(commands[i]->name);
         terminal_puts(": ");
-        terminal_println((*cmd)->description);
+        terminal_println(commands[i]->description);
     }
 }
 
@@ -23,38 +41,102 @@ static void help_cmd_handler(const cmd_args_t *args) {
     print_help();
 }
 
-/** Parse the command line tokens, replacing spaces with null characters in the buffer. */
-static void parse_arguments(cmd_args_t *args) {
-    args->count = 0;
-    for (
-        char *token = strtok(args->buf, " \t");
-        token && args->count < CLI_ARGC_MAX;
-        token = strtok(NULL, " \t")
-    ) {
-        args->tokens[args->count++] = token;
+cmd_args_t *cli_args_alloc() {
+    return pool_alloc(&args_pool);
+}
+
+void cli_args_free(cmd_args_t *args) {
+    pool_free(&args_pool, args);
+}
+
+bool cli_is_interactive() {
+    return xTaskGetCurrentTaskHandle() == cli_task_handle;
+}
+
+/**
+ * Find the output redirection (`> <sink>` or `><sink>`) at the end of the command.
+ *
+ * \param args The command.
+ * \param ntokens (out) The amount of tokens of the redirection.
+ *
+ * \return the sink name, or NULL if the output is not redirected.
+ */
+static const char *find_redirection(const cmd_args_t *args, int *ntokens) {
+    if (args->count >= 3 && !strcmp(args->tokens[args->count - 2], ">")) {
+        *ntokens = 2;
+        return args->tokens[args->count - 1];
+    }
+    if (args->count >= 2 && args->tokens[args->count - 1][0] == '>' && args->tokens[args->count - 1][1]) {
+        *ntokens = 1;
+        return args->tokens[args->count - 1] + 1;
     }
+    return NULL;
 }
 
-/** Remove `\r\n`. \return false if no newline characters were found. */
-static bool str_rstrip(char s[]) {
-    for (size_t i = 0; s[i]; i++) {
-        if (s[i] == '\n' || s[i] == '\r') {
-            s[i] = '\0';
-            return true;
-        }
+/** Output sink of a redirected command, which forwards to the target sink. */
+typedef struct {
+    /** Output sink. Must be the first member. */
+    terminal_sink_t sink;
+    /** Sink named in the redirection. */
+    terminal_sink_t *target;
+    /** Sink of the task before the redirection. */
+    terminal_sink_t *origin;
+} redirection_t;
+
+/** Redirection sink write function. */
+static void redirection_write(terminal_sink_t *sink, const void *data, size_t nbytes) {
+    terminal_sink_t *target = ((redirection_t *)sink)->target;
+    target->write(target, data, nbytes);
+}
+
+terminal_sink_t *cli_take_redirection() {
+    terminal_sink_t *sink = terminal_get_sink();
+    if (sink == NULL || sink->write != redirection_write) {
+        return sink;
     }
-    return false;
+    redirection_t *redirection = (redirection_t *)sink;
+    terminal_set_sink(redirection->origin);
+    return redirection->target;
 }
 
-void cli_extract_subcommand(const cmd_args_t *cmd, unsigned subcmd_arg_index, cmd_args_t *subcmd) {
-    memcpy(subcmd->buf, cmd->buf, CLI_LINE_MAX);
-    subcmd->count = cmd->count - subcmd_arg_index;
-    for (int i = 0; i < subcmd->count; i++) {
-        subcmd->tokens[i] = subcmd->buf + (cmd->tokens[subcmd_arg_index + i] - cmd->buf);
+/** Execute the command with its output redirected to the sink. */
+static void exec_redirected(const cmd_args_t *args, int redirection_ntokens, terminal_sink_t *sink) {
+    cmd_args_t *cmd = cli_args_alloc();
+    if (cmd == NULL) {
+        log_error("Out of command buffers; see `pool`");
+        return;
     }
+    cli_extract_subcommand(args, 0, cmd);
+    cmd->count -= redirection_ntokens;
+
+    redirection_t redirection = {.sink = {.write = redirection_write}, .target = sink};
+    redirection.origin = terminal_set_sink(&redirection.sink);
+    cli_exec_command(cmd);
+    terminal_set_sink(redirection.origin);
+
+    cli_args_free(cmd);
 }
 
 void cli_exec_command(const cmd_args_t *args) {
+    if (args->count >= 2 && !strcmp(args->tokens[args->count - 1], "&")) {
+        jobs_submit(args, args->count - 1);
+        return;
+    }
+
+    int redirection_ntokens;
+    const char *sink_name = find_redirection(args, &redirection_ntokens);
+    if (sink_name) {
+        terminal_sink_t *sink = buf_find_sink(sink_name);
+        if (!sink) {
+            terminal_puts("Unknown output buffer: '");
+            terminal_puts(sink_name);
+            terminal_println("'. Type 'buf' to see a list of available buffers.");
+            return;
+        }
+        exec_redirected(args, redirection_ntokens, sink);
+        return;
+    }
+
     const cmd_t *cmd = find_command(args->tokens[0]);
     if (!cmd) {
         terminal_puts("Unknown command: '");
@@ -65,6 +147,38 @@ void cli_exec_command(const cmd_args_t *args) {
     cmd->handler(args);
 }
 
+/**
+ * Show the prompt, read a command line into args and execute it. The line is parsed as
+ * each character arrives.
+ */
+static void cli_read_and_exec(cmd_args_t *args) {
+    terminal_puts("$ ");
+
+    tokenizer_t tokenizer;
+    tokenizer_init(&tokenizer, args);
+    tokenizer_status_t status;
+    do {
+        status = tokenizer_feed(&tokenizer, terminal_getc());
+    } while (status == TOKENIZER_MORE);
+
+    switch (status) {
+    case TOKENIZER_TOO_LONG:
+        log_error("Line is too long.");
+        return;
+    case TOKENIZER_TOO_MANY_ARGS:
+        log_error("Too many arguments.");
+        return;
+    default:
+        break;
+    }
+
+    if (args->count == 0) {
+        return;
+    }
+
+    cli_exec_command(args);
+}
+
 /**
  * RTOS task for the command line interface.
  *
@@ -76,46 +190,24 @@ static void cli_task(void *param) {
     terminal_println("RTOS CLI initialized.");
     print_help();
 
-    static cmd_args_t args = {0};
-
     while (1) {
-        terminal_puts("$ ");
-
-        terminal_gets(args.buf, CLI_LINE_MAX);
-        if (!str_rstrip(args.buf)) { // remove \r\n
-            log_error("Line is too long.");
-
-            // discard the rest of the line
-            do {
-                terminal_gets(args.buf, CLI_LINE_MAX);
-            } while (!str_rstrip(args.buf));
-
-            continue;
-        }
-
-        parse_arguments(&args);
-
-        if (args.count == 0) {
-            continue;
-        }
-
-        if (args.count >= CLI_ARGC_MAX) {
-            log_error("Too many arguments.");
-            continue;
-        }
-
-        cli_exec_command(&args);
+        cli_read_and_exec(&cli_args);
     }
 }
 
 bool cli_init() {
+    // a misplaced name would be unreachable
+    configASSERT(commands_sorted());
+    configASSERT(gpio_tables_sorted());
+    configASSERT(irq_tables_sorted());
+
     if (xTaskCreate(
         cli_task,
         "cliTask",
         configMINIMAL_STACK_SIZE * 2,
         0,
         CLI_TASK_PRIORITY,
-        0
+        &cli_task_handle
     ) != pdPASS) {
         log_error("Failed to create task");
         return false;
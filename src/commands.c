@@ -1,29 +1,50 @@
 #include <stddef.h>
-#include <string.h>
 #include "commands.h"
 #include "echo.h"
 #include "sleep.h"
 #include "loop.h"
+#include "watch.h"
+#include "jobs.h"
 #include "gpio.h"
 #include "irq.h"
 #include "i2c.h"
+#include "spi.h"
+#include "adc.h"
+#include "pool.h"
+#include "buf.h"
+#include "bulk.h"
+#include "log.h"
+#include "terminal.h"
+#include "lookup.h"
 
-const cmd_t *commands[] = {
-    &help_command,
+/** Sorted by name in `strcmp` order, for `find_command`. */
+const cmd_t *const commands[] = {
+    &adc_command,
+    &buf_command,
+    &bulk_command,
     &echo_command,
-    &sleep_command,
-    &loop_command,
     &gpio_command,
-    &irq_command,
+    &help_command,
     &i2c_command,
-    0,
+    &irq_command,
+    &jobs_command,
+    &kill_command,
+    &log_command,
+    &loop_command,
+    &pool_command,
+    &sleep_command,
+    &spi_command,
+    &terminal_command,
+    &wait_command,
+    &watch_command,
 };
 
+const size_t commands_count = ARRAY_SIZE(commands);
+
 const cmd_t *find_command(const char *name) {
-    for (const cmd_t **cmd = commands; *cmd; cmd++) {
-        if (strcmp((*cmd)->name, name) == 0) {
-            return *cmd;
-        }
-    }
-    return NULL;
+    return lookup_name_indirect(name, (const void *const *)commands, commands_count);
+}
+
+bool commands_sorted() {
+    return lookup_sorted_indirect((const void *const *)commands, commands_count);
 }
@@ -0,0 +1,96 @@
+#include "dma.h"
+#include "log.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** State of a DMA channel. */
+typedef struct {
+    /** True if the channel was reserved with dma_channel_open. */
+    bool open;
+    /** Completion callback. */
+    dma_callback_t callback;
+    /** Context for the callback. */
+    void *context;
+} dma_channel_t;
+
+static dma_channel_t channels[GPDMA_NUMBER_CHANNELS];
+
+/** True once the GPDMA controller has been initialized. */
+static bool initialized;
+
+/** DMA ISR: forward the completion of each channel to its callback. */
+void DMA_IRQHandler() {
+    BaseType_t woken = pdFALSE;
+
+    for (uint8_t ch = 0; ch < GPDMA_NUMBER_CHANNELS; ch++) {
+        if (!(LPC_GPDMA->INTSTAT & (1UL << ch))) {
+            continue;
+        }
+        // clears the terminal count or error flag of the channel
+        bool ok = Chip_GPDMA_Interrupt(LPC_GPDMA, ch) == SUCCESS;
+        if (!ok) {
+            LOG(LOG_DMA_ERROR, ch);
+        }
+        if (channels[ch].open && channels[ch].callback) {
+            channels[ch].callback(ch, ok, channels[ch].context, &woken);
+        }
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+int dma_channel_open(dma_callback_t callback, void *context) {
+    int channel = -1;
+
+    taskENTER_CRITICAL();
+    if (!initialized) {
+        Chip_GPDMA_Init(LPC_GPDMA);
+        NVIC_ClearPendingIRQ(DMA_IRQn);
+        NVIC_SetPriority(DMA_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+        NVIC_EnableIRQ(DMA_IRQn);
+        initialized = true;
+    }
+    // higher channel numbers have lower priority: hand out the lowest free channel
+    for (int ch = 0; ch < GPDMA_NUMBER_CHANNELS; ch++) {
+        if (!channels[ch].open) {
+            channels[ch] = (dma_channel_t) {
+                .open = true,
+                .callback = callback,
+                .context = context,
+            };
+            channel = ch;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return channel;
+}
+
+void dma_channel_close(int channel) {
+    if (channel < 0 || channel >= GPDMA_NUMBER_CHANNELS) {
+        return;
+    }
+    taskENTER_CRITICAL();
+    Chip_GPDMA_Stop(LPC_GPDMA, channel);
+    channels[channel].open = false;
+    taskEXIT_CRITICAL();
+}
+
+bool dma_start(int channel, uint32_t src, uint32_t dst, uint32_t type, uint32_t count) {
+    if (channel < 0 || channel >= GPDMA_NUMBER_CHANNELS || !channels[channel].open) {
+        return false;
+    }
+    if (count == 0 || count > DMA_TRANSFER_MAX) {
+        return false;
+    }
+    return Chip_GPDMA_Transfer(LPC_GPDMA, channel, src, dst, type, count) == SUCCESS;
+}
+
+void dma_stop(int channel) {
+    if (channel < 0 || channel >= GPDMA_NUMBER_CHANNELS) {
+        return;
+    }
+    Chip_GPDMA_Stop(LPC_GPDMA, channel);
+}
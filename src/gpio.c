@@ -5,6 +5,7 @@
 #include "semphr.h"
 #include "sapi.h"
 #include "terminal.h"
+#include "lookup.h"
 
 /** Print the `gpio` command usage help. */
 static void gpio_usage() {
@@ -17,56 +18,64 @@ static void gpio_usage() {
     );
 }
 
-/** GPIO port description and state. */
+/** GPIO port description. */
 typedef struct {
     /** GPIO port name. */
-    char *name;
+    const char *name;
     /** GPIO port pin number. */
     gpioMap_t pin;
-    /** Mutex to synchronize concurrent access. */
-    SemaphoreHandle_t mutex;
 } gpio_port_t;
 
 /** Utility macro to initialize the ports list. */
 #define MAKE_PORT(gpio_port) { \
     .name = #gpio_port, \
     .pin = gpio_port, \
-    .mutex = NULL, \
 }
 
-/** List of supported GPIO ports. */
-static gpio_port_t ports[] = {
+/** List of supported GPIO ports, sorted by name for `LOOKUP`. */
+static const gpio_port_t ports[] = {
+    MAKE_PORT(LED1),
+    MAKE_PORT(LED2),
+    MAKE_PORT(LED3),
+    MAKE_PORT(LEDB),
+    MAKE_PORT(LEDG),
+    MAKE_PORT(LEDR),
+
     MAKE_PORT(TEC1),
     MAKE_PORT(TEC2),
     MAKE_PORT(TEC3),
     MAKE_PORT(TEC4),
-
-    MAKE_PORT(LEDR),
-    MAKE_PORT(LEDG),
-    MAKE_PORT(LEDB),
-    MAKE_PORT(LED1),
-    MAKE_PORT(LED2),
-    MAKE_PORT(LED3),
-    {0},
 };
 
+/** Mutex of each port, to synchronize concurrent access. Created on first use. */
+static SemaphoreHandle_t mutexes[ARRAY_SIZE(ports)];
+
 /**
  * Find a gpio_port_t given its name.
  *
  * \return the port, or NULL if not found.
  */
-static gpio_port_t *find_port(const char *name) {
-    for (gpio_port_t *p = ports; p->name; p++) {
-        if (!strcmp(p->name, name)) {
-            return p;
-        }
+static const gpio_port_t *find_port(const char *name) {
+    return LOOKUP(ports, name);
+}
+
+bool gpio_find_pin(const char *name, gpioMap_t *out) {
+    const gpio_port_t *port = find_port(name);
+    if (!port) {
+        return false;
     }
-    return NULL;
+    *out = port->pin;
+    return true;
+}
+
+/** Return the mutex slot of the given port. */
+static SemaphoreHandle_t *port_mutex(const gpio_port_t *port) {
+    return &mutexes[port - ports];
 }
 
 /** Take the mutex for the given port. */
-static bool gpio_take_mutex(gpio_port_t *port) {
-    if (xSemaphoreTake(port->mutex, pdMS_TO_TICKS(100)) == pdFALSE) {
+static bool gpio_take_mutex(const gpio_port_t *port) {
+    if (xSemaphoreTake(*port_mutex(port), pdMS_TO_TICKS(100)) == pdFALSE) {
         log_error("Failed to take mutex");
         return false;
     }
@@ -74,28 +83,45 @@ static bool gpio_take_mutex(gpio_port_t *port) {
 }
 
 /** Release the mutex for the given port. */
-static bool gpio_release_mutex(gpio_port_t *port) {
-    if (xSemaphoreGive(port->mutex) == pdFALSE) {
+static bool gpio_release_mutex(const gpio_port_t *port) {
+    if (xSemaphoreGive(*port_mutex(port)) == pdFALSE) {
         log_error("Failed to release mutex");
         return false;
     }
     return true;
 }
 
+/** Name used to print each GPIO on/off value. */
+static const char *const on_off_names[] = {
+    [HIGH] = "high",
+    [LOW] = "low",
+};
+
+/** A token accepted for a GPIO on/off value. */
+typedef struct {
+    const char *name;
+    bool_t value;
+} on_off_token_t;
+
 /**
- * Describes the different ways the user can turn a GPIO port on or off.
+ * Describes the different ways the user can turn a GPIO port on or off, sorted by name
+ * for `LOOKUP`.
  *
  * Eg: `gpio LED1 write 1` and `gpio LED1 write high` are equivalent.
  */
-static const char *on_off_tokens[][4] = {
-    [HIGH] = {"high", "on", "1", 0},
-    [LOW] = {"low", "off", "0", 0},
+static const on_off_token_t on_off_tokens[] = {
+    {"0", LOW},
+    {"1", HIGH},
+    {"high", HIGH},
+    {"low", LOW},
+    {"off", LOW},
+    {"on", HIGH},
 };
 
 /** Return a string representing a GPIO on/off value. */
 static const char *on_off_to_string(bool_t value) {
     assert(value == HIGH || value == LOW);
-    return on_off_tokens[value][0];
+    return on_off_names[value];
 }
 
 /**
@@ -104,19 +130,16 @@ static const char *on_off_to_string(bool_t value) {
  * \return false if the name does not correspond to an on/off value.
  */
 static bool parse_on_off_value(const char *name, bool_t *out) {
-    for (bool_t on_off = LOW; on_off <= HIGH; on_off++) {
-        for (const char **s = on_off_tokens[on_off]; *s; s++) {
-            if (!strcmp(*s, name)) {
-                *out = on_off;
-                return true;
-            }
-        }
+    const on_off_token_t *token = LOOKUP(on_off_tokens, name);
+    if (!token) {
+        return false;
     }
-    return false;
+    *out = token->value;
+    return true;
 }
 
 /** `gpio <port> read` command handler function. */
-static void gpio_read_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
+static void gpio_read_cmd_handler(const gpio_port_t *port, const cmd_args_t *args) {
     cli_assert(args->count == 3, gpio_usage);
 
     if (!gpio_take_mutex(port)) {
@@ -129,7 +152,7 @@ static void gpio_read_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
 }
 
 /** `gpio <port> write` command handler function. */
-static void gpio_write_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
+static void gpio_write_cmd_handler(const gpio_port_t *port, const cmd_args_t *args) {
     cli_assert(args->count == 4, gpio_usage);
 
     bool_t on_off;
@@ -142,7 +165,7 @@ static void gpio_write_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
 }
 
 /** `gpio <port> toggle` command handler function. */
-static void gpio_toggle_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
+static void gpio_toggle_cmd_handler(const gpio_port_t *port, const cmd_args_t *args) {
     cli_assert(args->count == 3, gpio_usage);
 
     if (gpio_take_mutex(port)) {
@@ -152,27 +175,30 @@ static void gpio_toggle_cmd_handler(gpio_port_t *port, const cmd_args_t *args) {
 }
 
 /** `gpio <port> <subcommand>` handler function interface. */
-typedef void (*gpio_cmd_handler_t)(gpio_port_t *port, const cmd_args_t *args);
+typedef void (*gpio_cmd_handler_t)(const gpio_port_t *port, const cmd_args_t *args);
 
 /** `gpio <port> <subcommand>` definition. */
 typedef struct {
     /**
-     * Accepted tokens for `<subcommand>`.
+     * Accepted token for `<subcommand>`. Each subcommand is listed with its full name and
+     * its abbreviation.
      *
      * Eg: this allows the user to call `gpio LED1 read` or simply `gpio LED1 r`.
      */
-    char **tokens;
+    const char *name;
 
     /** Subcommand handler function. */
     gpio_cmd_handler_t handler;
 } gpio_cmd_token_t;
 
-/** List of `gpio` subcommands. */
-static gpio_cmd_token_t gpio_cmd_handlers[] = {
-    {(char *[]){"r", "read", 0}, gpio_read_cmd_handler},
-    {(char *[]){"w", "write", 0}, gpio_write_cmd_handler},
-    {(char *[]){"t", "toggle", 0}, gpio_toggle_cmd_handler},
-    {0},
+/** List of `gpio` subcommands, sorted by name for `LOOKUP`. */
+static const gpio_cmd_token_t gpio_cmd_handlers[] = {
+    {"r", gpio_read_cmd_handler},
+    {"read", gpio_read_cmd_handler},
+    {"t", gpio_toggle_cmd_handler},
+    {"toggle", gpio_toggle_cmd_handler},
+    {"w", gpio_write_cmd_handler},
+    {"write", gpio_write_cmd_handler},
 };
 
 /**
@@ -181,14 +207,12 @@ static gpio_cmd_token_t gpio_cmd_handlers[] = {
  * \return the subcommand, or NULL if not found.
  */
 static gpio_cmd_handler_t find_gpio_cmd(const char *name) {
-    for (gpio_cmd_token_t *s = gpio_cmd_handlers; s->tokens; s++) {
-        for (char **token = s->tokens; *token; token++) {
-            if (!strcmp(*token, name)) {
-                return s->handler;
-            }
-        }
-    }
-    return NULL;
+    const gpio_cmd_token_t *s = LOOKUP(gpio_cmd_handlers, name);
+    return s ? s->handler : NULL;
+}
+
+bool gpio_tables_sorted() {
+    return LOOKUP_SORTED(ports) && LOOKUP_SORTED(on_off_tokens) && LOOKUP_SORTED(gpio_cmd_handlers);
 }
 
 /** `gpio` command handler function. */
@@ -199,14 +223,15 @@ static void gpio_cmd_handler(const cmd_args_t *args) {
         return;
     }
     cli_assert(args->count >= 3, gpio_usage);
-    gpio_port_t *port = find_port(args->tokens[1]);
+    const gpio_port_t *port = find_port(args->tokens[1]);
     cli_assert(port, gpio_usage);
     gpio_cmd_handler_t command = find_gpio_cmd(args->tokens[2]);
     cli_assert(command, gpio_usage);
 
-    if (port->mutex == NULL) {
-        port->mutex = xSemaphoreCreateMutex();
-        if (port->mutex == NULL) {
+    SemaphoreHandle_t *mutex = port_mutex(port);
+    if (*mutex == NULL) {
+        *mutex = xSemaphoreCreateMutex();
+        if (*mutex == NULL) {
             log_error("Failed to create mutex");
             return;
         }
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include "hex.h"
+#include "cli.h"
+#include "terminal.h"
+
+bool hex_data_nbytes(const char *data_hex, size_t *out) {
+    if (strlen(data_hex) % 3 != 2) {
+        return false;
+    }
+    *out = strlen(data_hex) / 3 + 1;
+    return true;
+}
+
+bool hex_parse_data(const char *data_hex, size_t nbytes, uint8_t out[]) {
+    for (int i = 0; i < nbytes; i++) {
+        const char *s = &data_hex[3 * i];
+        if (s[2] != ':' && s[2] != '\0') {
+            return false;
+        }
+        const char hex_byte[] = {tolower(s[0]), tolower(s[1]), '\0'};
+
+        errno = 0;
+        out[i] = strtol(hex_byte, NULL, 16);
+        if (errno) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Return the value of a hex digit, or -1 if c is not a hex digit. */
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    c = tolower(c);
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+bool hex_parser_feed(hex_parser_t *parser, const char *s) {
+    for (; *s; s++) {
+        if (*s == ':' || *s == ' ' || *s == '\t') {
+            if (parser->high_nibble >= 0) {
+                return false;
+            }
+            continue;
+        }
+        int digit = hex_digit(*s);
+        if (digit < 0) {
+            return false;
+        }
+        if (parser->high_nibble < 0) {
+            parser->high_nibble = digit;
+            continue;
+        }
+        if (parser->nbytes == parser->max) {
+            return false;
+        }
+        parser->out[parser->nbytes++] = (parser->high_nibble << 4) | digit;
+        parser->high_nibble = -1;
+    }
+    return true;
+}
+
+bool hex_read_lines(size_t *nbytes, uint8_t out[], size_t max) {
+    hex_parser_t parser = {.out = out, .max = max, .nbytes = 0, .high_nibble = -1};
+    char line[CLI_LINE_MAX];
+    bool valid = true;
+    bool line_start = true;
+    while (true) {
+        terminal_gets(line, sizeof(line));
+        char *eol = strpbrk(line, "\r\n");
+        if (eol) {
+            *eol = '\0';
+            if (line_start && !line[0]) {
+                break;
+            }
+        }
+        if (valid) {
+            valid = hex_parser_feed(&parser, line);
+            if (eol && parser.high_nibble >= 0) {
+                // bytes cannot be split between lines
+                valid = false;
+            }
+        }
+        // a line longer than the buffer arrives in several chunks
+        line_start = eol != NULL;
+    }
+    *nbytes = parser.nbytes;
+    return valid;
+}
+
+bool hex_read_data(const char *token, size_t *nbytes, uint8_t out[], size_t max) {
+    if ((!strcmp(token, "-") || token[0] == '@') && !cli_is_interactive()) {
+        log_error("Data can only be read from the terminal by commands typed at the prompt");
+        return false;
+    }
+
+    if (!strcmp(token, "-")) {
+        return hex_read_lines(nbytes, out, max);
+    }
+
+    if (token[0] == '@') {
+        int n = atoi(&token[1]);
+        if (n <= 0 || n > max) {
+            log_error("Too much binary data");
+            return false;
+        }
+        *nbytes = terminal_read(out, n, HEX_BIN_TIMEOUT_MS);
+        if (*nbytes != n) {
+            log_error("Timeout while reading binary data");
+            return false;
+        }
+        return true;
+    }
+
+    if (!hex_data_nbytes(token, nbytes) || *nbytes > max) {
+        return false;
+    }
+    return hex_parse_data(token, *nbytes, out);
+}
+
+void hex_print(const uint8_t data[], size_t nbytes) {
+    char s[4];
+    for (int i = 0; i < nbytes; i++) {
+        sprintf(s, "%02x:", data[i]);
+        if (i == nbytes - 1) {
+            s[2] = '\0';
+        }
+        terminal_puts(s);
+    }
+    terminal_puts("\r\n");
+}
@@ -1,8 +1,13 @@
+#include <stdio.h>
 #include <string.h>
-#include <ctype.h>
 #include <errno.h>
 #include "i2c.h"
+#include "i2c_engine.h"
+#include "i2c_cache.h"
+#include "i2c_stream.h"
 #include "terminal.h"
+#include "hex.h"
+#include "pool.h"
 #include "sapi.h"
 #include "FreeRTOS.h"
 #include "semphr.h"
@@ -11,6 +16,26 @@
 #define RX_DATA_MAX 256
 /** Maximum size of transmit data buffer (bytes) */
 #define TX_DATA_MAX 256
+/** Maximum time to wait for a transaction to complete (ms) */
+#define I2C_TIMEOUT_MS 100
+/** Maximum time to wait for each address probe during a scan (ms) */
+#define I2C_SCAN_TIMEOUT_MS 2
+/** First 7-bit address probed by `i2c scan` (lower ones are reserved) */
+#define I2C_SCAN_FIRST 0x08
+/** Last 7-bit address probed by `i2c scan` (higher ones are reserved) */
+#define I2C_SCAN_LAST 0x77
+/** Maximum amount of transactions in a batch */
+#define BATCH_MAX 8
+/** Size of the data buffer shared by all transactions in a batch (bytes) */
+#define BATCH_DATA_MAX (TX_DATA_MAX + RX_DATA_MAX)
+/** Amount of tx/rx data buffers, shared by all the tasks running `i2c slave` */
+#define DATA_BUFFERS 4
+/** Amount of batch buffers, shared by all the tasks running `i2c batch` */
+#define BATCH_BUFFERS 2
+
+// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
+#define str(a) #a
+#define xstr(a) str(a)
 
 /** Print the `i2c` command usage help. */
 static void usage() {
@@ -32,13 +57,58 @@ static void usage() {
         "\r\n"
         "  slave <device_address> rx <rx_nbytes> [no]stop\r\n"
         "      Eg: i2c slave 50 rx 4 nostop\r\n"
+        "\r\n"
+        "  <tx_data...> can also be:\r\n"
+        "    - : read hex data (eg: `00 10 de:ad:be:ef`) from the following lines, until an\r\n"
+        "        empty line, up to " xstr(TX_DATA_MAX) " bytes\r\n"
+        "    @<nbytes> : read <nbytes> of binary data right after the command line\r\n"
+        "    Both are only allowed at the prompt, not in `loop`, `watch`, `irq` or `&`.\r\n"
+        "      Eg: i2c slave 50 tx - stop\r\n"
+        "\r\n"
+        "  scan [clear]\r\n"
+        "      Probe all addresses and remember which devices are present. Transactions\r\n"
+        "      to devices known to be absent then fail without using the bus. Addresses\r\n"
+        "      that cannot be probed (eg: the bus is busy with `i2c stream`) keep their\r\n"
+        "      previous state. `clear` forgets the scan results.\r\n"
+        "\r\n"
+        "  cache <device_address> [<register>] cacheable|volatile\r\n"
+        "      Mark all registers of a device, or a single one, as cacheable or volatile\r\n"
+        "      (default). `i2c slave` register reads (tx <reg> rx <n> stop) of cacheable\r\n"
+        "      registers are served from the cache, and register writes (tx <reg>:<data> stop)\r\n"
+        "      of unchanged values are skipped.\r\n"
+        "      Eg: i2c cache 50 cacheable\r\n"
+        "          i2c cache 50 0f volatile\r\n"
+        "\r\n"
+        "  cache stats|clear|reset\r\n"
+        "      Show hit rates, forget cached values, or forget values and policies.\r\n"
+        "\r\n"
+        "  stream <device_address> <register> <nbytes> <rate_hz>\r\n"
+        "      Sample <nbytes> from <register> at <rate_hz> (max " xstr(I2C_STREAM_RATE_MAX) ") into a RAM buffer,\r\n"
+        "      from a hardware timer. Samples bypass the bus mutex and the caches; they are\r\n"
+        "      skipped while a task holds the bus between transactions, and aborted after 5 ms.\r\n"
+        "      Eg: i2c stream 68 3b 6 1000\r\n"
+        "\r\n"
+        "  stream stop|stat\r\n"
+        "      Stop sampling, or show the sample, overrun and error counters.\r\n"
+        "\r\n"
+        "  stream dump [<max_records>]\r\n"
+        "      Drain the buffer: prints `STREAM <records> <record_size>` and then the records\r\n"
+        "      in binary, each one a little endian uint32 timestamp (us) followed by the sample.\r\n"
+        "\r\n"
+        "  batch <device_address> [tx <tx_data...> [[no]stop]] [rx <rx_nbytes> [[no]stop]] [; ...]\r\n"
+        "      Runs all transactions in a single bus acquisition. A tx section followed by\r\n"
+        "      rx defaults to nostop (repeated start); everything else defaults to stop.\r\n"
+        "      Eg: i2c batch 50 tx 00 rx 6 ; 51 tx 10 rx 2 ; 50 tx 20:01\r\n"
+        "\r\n"
+        "  batch bin <nbytes>\r\n"
+        "      Reads <nbytes> of binary batch description from the terminal. Each transaction is\r\n"
+        "      <addr> <flags> <tx_nbytes> <tx_data...> <rx_nbytes>, with flags bit 0 = tx stop and\r\n"
+        "      bit 1 = rx stop. The reply is, for each transaction, a status byte (0 = ok,\r\n"
+        "      1 = nack, 2 = error, 3 = timeout, 4 = skipped) followed by the received data if ok.\r\n"
+        "      Only allowed at the prompt.\r\n"
     );
 }
 
-// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
-#define str(a) #a
-#define xstr(a) str(a)
-
 /**
  * Global i2c configuration, controlled with `i2c init`.
  *
@@ -49,6 +119,53 @@ static unsigned int i2c_freq_hz = 0;
 /** Mutex to synchronize concurrent access. */
 static SemaphoreHandle_t i2c_mutex;
 
+/** Buffers for the data of a single transfer. */
+POOL_DEFINE(data_pool, "i2c data", TX_DATA_MAX > RX_DATA_MAX ? TX_DATA_MAX : RX_DATA_MAX, DATA_BUFFERS);
+
+/** Transactions and data of a batch. */
+typedef struct {
+    i2c_xfer_t xfers[BATCH_MAX];
+    uint8_t data[BATCH_DATA_MAX];
+} batch_t;
+
+/** Buffers for batches. */
+POOL_DEFINE(batch_pool, "i2c batch", sizeof(batch_t), BATCH_BUFFERS);
+
+/** Bitmap of addresses probed by `i2c scan`. */
+static uint32_t presence_known[128 / 32];
+/** Bitmap of addresses that acknowledged the last probe or transaction. */
+static uint32_t presence_found[128 / 32];
+
+/** Update the presence cache for the given address. */
+static void presence_set(uint8_t address, bool present) {
+    uint32_t bit = 1UL << (address % 32);
+    presence_known[address / 32] |= bit;
+    if (present) {
+        presence_found[address / 32] |= bit;
+    } else {
+        presence_found[address / 32] &= ~bit;
+    }
+}
+
+/** Return true if the address was probed and the device did not acknowledge. */
+static bool presence_absent(uint8_t address) {
+    uint32_t bit = 1UL << (address % 32);
+    return (presence_known[address / 32] & bit) && !(presence_found[address / 32] & bit);
+}
+
+/**
+ * Check the presence cache before starting a transaction.
+ *
+ * \return false (after printing an error) if the device is known to be absent.
+ */
+static bool check_present(uint8_t address) {
+    if (presence_absent(address)) {
+        log_error("i2c device not present (use `i2c scan` or `i2c scan clear` to refresh)");
+        return false;
+    }
+    return true;
+}
+
 static bool i2c_take_mutex() {
     if (xSemaphoreTake(i2c_mutex, pdMS_TO_TICKS(100)) == pdFALSE) {
         log_error("Failed to take mutex");
@@ -86,74 +203,13 @@ static void i2c_init(const cmd_args_t *args) {
         if (!i2c_take_mutex()) {
             return;
         }
-        if (!i2cInit(I2C0, i2c_freq_hz)) {
+        if (!i2c_engine_init(i2c_freq_hz)) {
             log_error("Failed to initialize i2c interface");
         }
         i2c_release_mutex();
     }
 }
 
-/**
- * Given a sequence of bytes expressed in hex format, this function returns the amount of
- * bytes needed to parse it.
- *
- * Eg: `parse_data_nbytes("aa:bb:cc:dd:ee", &out) sets `*out = 5`.
- *
- * \param data_hex The input string.
- * \param out Output variable that will store the detected amount of bytes.
- *
- * \return false if the data cannot be parsed successfully.
- */
-static bool parse_data_nbytes(const char *data_hex, size_t *out) {
-    if (strlen(data_hex) % 3 != 2) {
-        return false;
-    }
-    *out = strlen(data_hex) / 3 + 1;
-    return true;
-}
-
-/**
- * Parse a sequence of bytes expressed in hex format.
- *
- * \param data_hex The input string.
- * \param nbytes The amount of bytes expressed in data_hex. It should have been previously
- *               computed with parse_data_nbytes.
- * \param out A buffer containing space for nbytes bytes.
- *
- * Eg: `parse_data_nbytes("aa:bb:cc:dd:ee", 5, out) sets `out = {0xaa, 0xbb, 0xcc, 0xdd, 0xee}`.
- *
- * \return false if the data cannot be parsed successfully.
- */
-static bool parse_data(const char *data_hex, uint8_t nbytes, uint8_t out[]) {
-    for (int i = 0; i < nbytes; i++) {
-        const char *s = &data_hex[3 * i];
-        if (s[2] != ':' && s[2] != '\0') {
-            return false;
-        }
-        const char hex_byte[] = {tolower(s[0]), tolower(s[1]), '\0'};
-
-        errno = 0;
-        out[i] = strtol(hex_byte, NULL, 16);
-        if (errno) {
-            return false;
-        }
-    }
-    return true;
-}
-
-/** Print a sequence of bytes in hexadecimal format. */
-static void print_data(uint8_t data[], size_t nbytes) {
-    char s[4];
-    for (int i = 0; i < nbytes; i++) {
-        sprintf(s, "%02x:", data[i]);
-        if (i == nbytes - 1) {
-            s[2] = '\0';
-        }
-        terminal_puts(s);
-    }
-    terminal_puts("\r\n");
-}
-
 /**
  * Parse a 7-bit i2c device addres in hex format (eg: `"5a"`).
  *
@@ -181,11 +237,11 @@ static bool parse_device_address(const char *s, uint8_t *out) {
  */
 static bool parse_stop(const char *s, bool *out) {
     if (!strcmp(s, "stop")) {
-        return *out = true;
+        *out = true;
         return true;
     }
     if (!strcmp(s, "nostop")) {
-        return *out = false;
+        *out = false;
         return true;
     }
     return false;
@@ -222,54 +278,117 @@ static bool parse_read(const cmd_args_t *args, unsigned token_index, size_t *rx_
  * \return false if the tx section cannot be parsed successfully starting from token_index.
  */
 static bool parse_write(const cmd_args_t *args, unsigned token_index, size_t *tx_nbytes, uint8_t tx_data[], bool *tx_stop) {
-    if (!parse_data_nbytes(args->tokens[token_index + 1], tx_nbytes)) {
+    // parse the stop condition first, so that no input is read for an invalid command
+    if (!parse_stop(args->tokens[token_index + 2], tx_stop)) {
         return false;
     }
-    if (*tx_nbytes >= TX_DATA_MAX) {
-        log_error("Cannot tx more than " xstr(TX_DATA_MAX) " bytes");
-        return false;
+    return hex_read_data(args->tokens[token_index + 1], tx_nbytes, tx_data, TX_DATA_MAX);
+}
+
+/**
+ * Execute a transaction, going through the register cache when the transaction is a
+ * single-byte register pointer followed by a read, or a register write. Any other
+ * transaction that writes registers (eg: with `nostop`, or followed by a read), and any
+ * failed write, invalidates the written registers. Must be called with the mutex held.
+ *
+ * \return the transaction status.
+ */
+static i2c_xfer_status_t cached_transfer(i2c_xfer_t *xfer) {
+    bool register_read = xfer->tx_nbytes == 1 && xfer->rx_nbytes > 0 && xfer->rx_stop;
+    bool register_write = xfer->tx_nbytes >= 2 && xfer->rx_nbytes == 0 && xfer->tx_stop;
+
+    if (register_read && i2c_cache_read(xfer->address, xfer->tx_data[0], xfer->rx_data, xfer->rx_nbytes)) {
+        return xfer->status = I2C_XFER_DONE;
     }
-    if (!parse_data(args->tokens[token_index + 1], *tx_nbytes, tx_data)) {
-        return false;
+    if (register_write && i2c_cache_write(xfer->address, xfer->tx_data[0], &xfer->tx_data[1], xfer->tx_nbytes - 1)) {
+        return xfer->status = I2C_XFER_DONE;
+    }
+
+    i2c_xfer_status_t status = i2c_engine_transfer(xfer, pdMS_TO_TICKS(I2C_TIMEOUT_MS));
+    if (status == I2C_XFER_DONE) {
+        presence_set(xfer->address, true);
+    }
+    if (status == I2C_XFER_DONE && register_read) {
+        i2c_cache_store(xfer->address, xfer->tx_data[0], xfer->rx_data, xfer->rx_nbytes);
+    } else if (status == I2C_XFER_DONE && register_write) {
+        i2c_cache_store(xfer->address, xfer->tx_data[0], &xfer->tx_data[1], xfer->tx_nbytes - 1);
+    } else if (xfer->tx_nbytes >= 2) {
+        // the device may have taken some of the bytes
+        i2c_cache_invalidate_range(xfer->address, xfer->tx_data[0], xfer->tx_nbytes - 1);
+    }
+    return status;
+}
+
+/** Print an error message describing a failed transaction status. */
+static void print_xfer_error(i2c_xfer_status_t status) {
+    switch (status) {
+    case I2C_XFER_NACK:
+        log_error("i2c device did not acknowledge");
+        break;
+    case I2C_XFER_TIMEOUT:
+        log_error("i2c transaction timed out");
+        break;
+    default:
+        log_error("i2c bus error");
+        break;
     }
-    return parse_stop(args->tokens[token_index + 2], tx_stop);
 }
 
 /** Perform a write-read sequence on the I2C slave device and then print the received data. */
 static void i2c_write_read_print(uint8_t device_address, size_t tx_nbytes, uint8_t tx_data[], bool tx_stop, size_t rx_nbytes, bool rx_stop) {
-    static uint8_t rx_data[RX_DATA_MAX];
-
-    if (!i2c_take_mutex()) {
+    uint8_t *rx_data = pool_alloc(&data_pool);
+    if (rx_data == NULL) {
+        log_error("Out of i2c buffers; see `pool`");
         return;
     }
-    bool_t success = i2cRead(I2C0, device_address, tx_data, tx_nbytes, true, rx_data, rx_nbytes, true);
-    i2c_release_mutex();
 
-    if (!success) {
-        log_error("Failed to read from i2c device");
-        return;
-    }
+    i2c_xfer_t xfer = {
+        .address = device_address,
+        .tx_data = tx_data,
+        .tx_nbytes = tx_nbytes,
+        .tx_stop = tx_stop,
+        .rx_data = rx_data,
+        .rx_nbytes = rx_nbytes,
+        .rx_stop = rx_stop,
+    };
+
+    if (check_present(device_address) && i2c_take_mutex()) {
+        i2c_xfer_status_t status = cached_transfer(&xfer);
+        i2c_release_mutex();
 
-    print_data(rx_data, rx_nbytes);
+        if (status == I2C_XFER_DONE) {
+            hex_print(rx_data, rx_nbytes);
+        } else {
+            log_error("Failed to read from i2c device");
+            print_xfer_error(status);
+        }
+    }
+    pool_free(&data_pool, rx_data);
 }
 
 /** Transmit data to the I2C slave device. */
 static void i2c_write(uint8_t device_address, size_t tx_nbytes, uint8_t tx_data[], bool stop) {
-    if (!i2c_take_mutex()) {
+    i2c_xfer_t xfer = {
+        .address = device_address,
+        .tx_data = tx_data,
+        .tx_nbytes = tx_nbytes,
+        .tx_stop = stop,
+    };
+
+    if (!check_present(device_address) || !i2c_take_mutex()) {
         return;
     }
-    if (!i2cWrite(I2C0, device_address, tx_data, tx_nbytes, stop)) {
+    i2c_xfer_status_t status = cached_transfer(&xfer);
+    i2c_release_mutex();
+
+    if (status != I2C_XFER_DONE) {
         log_error("Failed to write to i2c device");
+        print_xfer_error(status);
     }
-    i2c_release_mutex();
 }
 
-/** `i2c slave ...` command handler. */
-static void i2c_slave(const cmd_args_t *args) {
-    if (!i2c_freq_hz) {
-        log_error("`i2c init` must be called first.");
-        return;
-    }
+/** Parse and execute `i2c slave ...`, using the given buffer for the tx data. */
+static void i2c_slave_exec(const cmd_args_t *args, uint8_t tx_data[]) {
     cli_assert(args->count >= 6, usage);
 
     uint8_t device_address;
@@ -277,7 +396,6 @@ static void i2c_slave(const cmd_args_t *args) {
 
     // arguments for `tx` section
     size_t tx_nbytes = 0;
-    static uint8_t tx_data[TX_DATA_MAX];
     bool tx_stop = true;
 
     // arguments for `rx` section
@@ -309,6 +427,448 @@ static void i2c_slave(const cmd_args_t *args) {
     cli_assert(false, usage);
 }
 
+/** `i2c slave ...` command handler. */
+static void i2c_slave(const cmd_args_t *args) {
+    if (!i2c_freq_hz) {
+        log_error("`i2c init` must be called first.");
+        return;
+    }
+    uint8_t *tx_data = pool_alloc(&data_pool);
+    if (tx_data == NULL) {
+        log_error("Out of i2c buffers; see `pool`");
+        return;
+    }
+    i2c_slave_exec(args, tx_data);
+    pool_free(&data_pool, tx_data);
+}
+
+/** Status reported for batch transactions that were not executed after a failure. */
+#define BATCH_SKIPPED (I2C_XFER_TIMEOUT + 1)
+
+/**
+ * Execute a list of transactions in a single bus acquisition.
+ *
+ * Execution stops at the first failed transaction, since the following ones may depend
+ * on it (eg: a repeated start sequence).
+ *
+ * \return the amount of executed transactions, or -1 if the bus could not be acquired.
+ */
+static int i2c_run_batch(i2c_xfer_t xfers[], unsigned count) {
+    for (unsigned i = 0; i < count; i++) {
+        if (!check_present(xfers[i].address)) {
+            return -1;
+        }
+    }
+    if (!i2c_take_mutex()) {
+        return -1;
+    }
+    unsigned i;
+    for (i = 0; i < count; i++) {
+        if (cached_transfer(&xfers[i]) != I2C_XFER_DONE) {
+            i++;
+            break;
+        }
+    }
+    i2c_release_mutex();
+    return i;
+}
+
+/**
+ * Parse one transaction of the `i2c batch` command line.
+ *
+ * \param args The tokenized comand line arguments
+ * \param token_index (in/out) The current token index; on return, the index of the token
+ *                    following the transaction (and its `;` separator).
+ * \param xfer (out) The parsed transaction.
+ * \param data (in/out) Free space in the batch data buffer; advanced past the used bytes.
+ * \param data_end End of the batch data buffer.
+ *
+ * \return false if the transaction cannot be parsed successfully.
+ */
+static bool parse_batch_xfer(const cmd_args_t *args, unsigned *token_index, i2c_xfer_t *xfer, uint8_t **data, uint8_t *data_end) {
+    unsigned i = *token_index;
+    memset(xfer, 0, sizeof(*xfer));
+    xfer->rx_stop = true;
+
+    if (i >= args->count || !parse_device_address(args->tokens[i++], &xfer->address)) {
+        return false;
+    }
+
+    bool tx_stop_given = false;
+    if (i + 1 < args->count && !strcmp(args->tokens[i], "tx")) {
+        size_t nbytes;
+        if (!hex_data_nbytes(args->tokens[i + 1], &nbytes) || nbytes > data_end - *data) {
+            return false;
+        }
+        if (!hex_parse_data(args->tokens[i + 1], nbytes, *data)) {
+            return false;
+        }
+        xfer->tx_data = *data;
+        xfer->tx_nbytes = nbytes;
+        *data += nbytes;
+        i += 2;
+        if (i < args->count && parse_stop(args->tokens[i], &xfer->tx_stop)) {
+            tx_stop_given = true;
+            i++;
+        }
+    }
+
+    if (i + 1 < args->count && !strcmp(args->tokens[i], "rx")) {
+        int nbytes = atoi(args->tokens[i + 1]);
+        if (nbytes <= 0 || nbytes > data_end - *data) {
+            return false;
+        }
+        xfer->rx_data = *data;
+        xfer->rx_nbytes = nbytes;
+        *data += nbytes;
+        i += 2;
+        if (i < args->count && parse_stop(args->tokens[i], &xfer->rx_stop)) {
+            i++;
+        }
+    }
+
+    if (!tx_stop_given) {
+        xfer->tx_stop = xfer->rx_nbytes == 0;
+    }
+
+    if (i < args->count) {
+        if (strcmp(args->tokens[i], ";")) {
+            return false;
+        }
+        i++;
+    }
+    *token_index = i;
+    return true;
+}
+
+/** Print the result of a text batch. */
+static void print_batch_results(const i2c_xfer_t xfers[], unsigned count, unsigned executed) {
+    static const char *status_names[] = {
+        [I2C_XFER_BUSY] = "busy",
+        [I2C_XFER_DONE] = "ok",
+        [I2C_XFER_NACK] = "nack",
+        [I2C_XFER_ERROR] = "error",
+        [I2C_XFER_TIMEOUT] = "timeout",
+    };
+    char s[8];
+    for (unsigned i = 0; i < count; i++) {
+        snprintf(s, sizeof(s), "%02x: ", xfers[i].address);
+        terminal_puts(s);
+        if (i >= executed) {
+            terminal_println("skipped");
+            continue;
+        }
+        terminal_puts(status_names[xfers[i].status]);
+        if (xfers[i].status == I2C_XFER_DONE && xfers[i].rx_nbytes > 0) {
+            terminal_putc(' ');
+            hex_print(xfers[i].rx_data, xfers[i].rx_nbytes);
+        } else {
+            terminal_puts("\r\n");
+        }
+    }
+}
+
+/**
+ * Parse a binary batch description.
+ *
+ * \return the amount of parsed transactions, or -1 if the description is invalid.
+ */
+static int parse_batch_bin(uint8_t *desc, size_t desc_nbytes, i2c_xfer_t xfers[], uint8_t *rx_data, uint8_t *rx_data_end) {
+    uint8_t *p = desc;
+    uint8_t *end = desc + desc_nbytes;
+    unsigned count = 0;
+    while (p < end) {
+        if (count == BATCH_MAX || end - p < 4) {
+            return -1;
+        }
+        i2c_xfer_t *xfer = &xfers[count++];
+        memset(xfer, 0, sizeof(*xfer));
+        xfer->address = p[0] & 0x7f;
+        xfer->tx_stop = p[1] & 0x01;
+        xfer->rx_stop = p[1] & 0x02;
+        xfer->tx_nbytes = p[2];
+        xfer->tx_data = &p[3];
+        p += 3 + xfer->tx_nbytes;
+        if (p >= end) {
+            return -1;
+        }
+        xfer->rx_nbytes = *p++;
+        if (xfer->rx_nbytes > rx_data_end - rx_data) {
+            return -1;
+        }
+        xfer->rx_data = rx_data;
+        rx_data += xfer->rx_nbytes;
+    }
+    return count;
+}
+
+/** `i2c batch bin <nbytes>` command handler. */
+static void i2c_batch_bin(const cmd_args_t *args, batch_t *batch) {
+    i2c_xfer_t *xfers = batch->xfers;
+    uint8_t *data = batch->data;
+
+    cli_assert(args->count == 4, usage);
+    int desc_nbytes = atoi(args->tokens[3]);
+    cli_assert(desc_nbytes > 0 && desc_nbytes <= TX_DATA_MAX, usage);
+    if (!cli_is_interactive()) {
+        log_error("Data can only be read from the terminal by commands typed at the prompt");
+        return;
+    }
+
+    // the description goes at the end of the buffer, and received data at the beginning
+    uint8_t *desc = data + BATCH_DATA_MAX - desc_nbytes;
+    if (terminal_read(desc, desc_nbytes, HEX_BIN_TIMEOUT_MS) != desc_nbytes) {
+        log_error("Timeout while reading the batch description");
+        return;
+    }
+
+    int count = parse_batch_bin(desc, desc_nbytes, xfers, data, desc);
+    if (count < 0) {
+        log_error("Invalid batch description");
+        return;
+    }
+
+    int executed = i2c_run_batch(xfers, count);
+    if (executed < 0) {
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        uint8_t status = i < executed ? xfers[i].status - I2C_XFER_DONE : BATCH_SKIPPED - I2C_XFER_DONE;
+        terminal_write(&status, 1);
+        if (i < executed && xfers[i].status == I2C_XFER_DONE) {
+            terminal_write(xfers[i].rx_data, xfers[i].rx_nbytes);
+        }
+    }
+}
+
+/** Parse and execute `i2c batch ...`, using the given batch buffer. */
+static void i2c_batch_exec(const cmd_args_t *args, batch_t *batch) {
+    i2c_xfer_t *xfers = batch->xfers;
+    uint8_t *data = batch->data;
+
+    cli_assert(args->count >= 3, usage);
+
+    if (!strcmp(args->tokens[2], "bin")) {
+        // background output would corrupt the binary results
+        if (terminal_begin_binary()) {
+            i2c_batch_bin(args, batch);
+            terminal_end_binary();
+        }
+        return;
+    }
+
+    unsigned count = 0;
+    unsigned token_index = 2;
+    uint8_t *free_data = data;
+    while (token_index < args->count) {
+        cli_assert(count < BATCH_MAX, usage);
+        cli_assert(parse_batch_xfer(args, &token_index, &xfers[count], &free_data, data + BATCH_DATA_MAX), usage);
+        count++;
+    }
+
+    int executed = i2c_run_batch(xfers, count);
+    if (executed < 0) {
+        return;
+    }
+    print_batch_results(xfers, count, executed);
+}
+
+/** `i2c batch ...` command handler. */
+static void i2c_batch(const cmd_args_t *args) {
+    if (!i2c_freq_hz) {
+        log_error("`i2c init` must be called first.");
+        return;
+    }
+    batch_t *batch = pool_alloc(&batch_pool);
+    if (batch == NULL) {
+        log_error("Out of i2c batch buffers; see `pool`");
+        return;
+    }
+    i2c_batch_exec(args, batch);
+    pool_free(&batch_pool, batch);
+}
+
+/** `i2c scan [clear]` command handler. */
+static void i2c_scan(const cmd_args_t *args) {
+    if (args->count == 3 && !strcmp(args->tokens[2], "clear")) {
+        memset(presence_known, 0, sizeof(presence_known));
+        memset(presence_found, 0, sizeof(presence_found));
+        return;
+    }
+    cli_assert(args->count == 2, usage);
+
+    if (!i2c_freq_hz) {
+        log_error("`i2c init` must be called first.");
+        return;
+    }
+    if (!i2c_take_mutex()) {
+        return;
+    }
+    unsigned unknown = 0;
+    for (uint8_t address = I2C_SCAN_FIRST; address <= I2C_SCAN_LAST; address++) {
+        i2c_xfer_t xfer = {.address = address, .tx_stop = true};
+        i2c_xfer_status_t status = i2c_engine_transfer(&xfer, pdMS_TO_TICKS(I2C_SCAN_TIMEOUT_MS));
+        if (status == I2C_XFER_DONE || status == I2C_XFER_NACK) {
+            presence_set(address, status == I2C_XFER_DONE);
+        } else {
+            // a timeout may only mean that the engine was busy (eg: `i2c stream`); only a
+            // NACK proves that the device is absent
+            unknown++;
+        }
+    }
+    i2c_release_mutex();
+
+    terminal_puts("Devices found:");
+    char s[80];
+    for (uint8_t address = I2C_SCAN_FIRST; address <= I2C_SCAN_LAST; address++) {
+        if (presence_found[address / 32] & (1UL << (address % 32))) {
+            snprintf(s, sizeof(s), " %02x", address);
+            terminal_puts(s);
+        }
+    }
+    terminal_puts("\r\n");
+    if (unknown > 0) {
+        snprintf(s, sizeof(s), "Error: %u addresses not probed (bus busy); their state is unchanged", unknown);
+        terminal_println(s);
+    }
+}
+
+/** Print a cache hit counter along with its hit rate. */
+static void print_hit_rate(const char *name, uint32_t hits, uint32_t misses) {
+    char s[48];
+    uint32_t total = hits + misses;
+    snprintf(s, sizeof(s), "%s: %lu hits, %lu misses (%lu%%)", name,
+        (unsigned long)hits, (unsigned long)misses, (unsigned long)(total ? hits * 100ULL / total : 0));
+    terminal_println(s);
+}
+
+/** `i2c cache ...` command handler. */
+static void i2c_cache(const cmd_args_t *args) {
+    cli_assert(args->count >= 3 && args->count <= 5, usage);
+
+    if (i2c_mutex == NULL) {
+        log_error("`i2c init` must be called first.");
+        return;
+    }
+    if (!i2c_take_mutex()) {
+        return;
+    }
+
+    if (args->count == 3 && !strcmp(args->tokens[2], "stats")) {
+        i2c_cache_stats_t stats = *i2c_cache_stats();
+        i2c_release_mutex();
+        print_hit_rate("Reads", stats.read_hits, stats.read_misses);
+        print_hit_rate("Writes", stats.write_hits, stats.write_misses);
+        char s[32];
+        snprintf(s, sizeof(s), "Cache full: %lu", (unsigned long)stats.full);
+        terminal_println(s);
+        return;
+    }
+
+    bool valid = true;
+    if (args->count == 3 && !strcmp(args->tokens[2], "clear")) {
+        i2c_cache_invalidate();
+    } else if (args->count == 3 && !strcmp(args->tokens[2], "reset")) {
+        i2c_cache_reset();
+    } else {
+        // i2c cache <device_address> [<register>] cacheable|volatile
+        uint8_t device_address;
+        uint8_t reg;
+        const char *policy = args->tokens[args->count - 1];
+        valid = parse_device_address(args->tokens[2], &device_address)
+            && (args->count == 4 || parse_device_address(args->tokens[3], &reg))
+            && (!strcmp(policy, "cacheable") || !strcmp(policy, "volatile"));
+        if (valid && !i2c_cache_set_policy(device_address, args->count == 4 ? -1 : reg, !strcmp(policy, "cacheable"))) {
+            log_error("Too many cache policies. Use `i2c cache reset` to free them.");
+        }
+    }
+    i2c_release_mutex();
+    cli_assert(valid, usage);
+}
+
+/** Print a named counter. */
+static void print_counter(const char *name, unsigned long n) {
+    char s[32];
+    snprintf(s, sizeof(s), "%s: %lu", name, n);
+    terminal_println(s);
+}
+
+/** `i2c stream dump [<max_records>]` command handler. */
+static void i2c_stream_dump(const cmd_args_t *args) {
+    size_t records = i2c_stream_available();
+    if (args->count == 4) {
+        int max_records = atoi(args->tokens[3]);
+        cli_assert(max_records >= 0, usage);
+        if (records > max_records) {
+            records = max_records;
+        }
+    }
+    size_t record_size = i2c_stream_record_size();
+
+    char s[32];
+    snprintf(s, sizeof(s), "STREAM %lu %lu", (unsigned long)records, (unsigned long)record_size);
+    terminal_println(s);
+
+    uint8_t chunk[I2C_STREAM_RECORD_SIZE(I2C_STREAM_NBYTES_MAX)];
+    for (size_t i = 0; i < records; i++) {
+        size_t nbytes = i2c_stream_read(chunk, record_size);
+        terminal_write(chunk, nbytes);
+    }
+}
+
+/** `i2c stream ...` command handler. */
+static void i2c_stream(const cmd_args_t *args) {
+    cli_assert(args->count >= 3, usage);
+
+    if (args->count == 3 && !strcmp(args->tokens[2], "stop")) {
+        i2c_stream_stop();
+        return;
+    }
+
+    if (args->count == 3 && !strcmp(args->tokens[2], "stat")) {
+        i2c_stream_stats_t stats = i2c_stream_stats();
+        terminal_println(i2c_stream_running() ? "Running" : "Stopped");
+        print_counter("Samples", stats.samples);
+        print_counter("Buffered", i2c_stream_available());
+        print_counter("Overruns", stats.overruns);
+        print_counter("Buffer full", stats.full);
+        print_counter("Errors", stats.errors);
+        return;
+    }
+
+    if (args->count <= 4 && !strcmp(args->tokens[2], "dump")) {
+        // background output would corrupt the binary records
+        if (terminal_begin_binary()) {
+            i2c_stream_dump(args);
+            terminal_end_binary();
+        }
+        return;
+    }
+
+    // i2c stream <device_address> <register> <nbytes> <rate_hz>
+    cli_assert(args->count == 6, usage);
+    if (!i2c_freq_hz) {
+        log_error("`i2c init` must be called first.");
+        return;
+    }
+    uint8_t device_address;
+    uint8_t reg;
+    cli_assert(parse_device_address(args->tokens[2], &device_address), usage);
+    cli_assert(parse_device_address(args->tokens[3], &reg), usage);
+    int nbytes = atoi(args->tokens[4]);
+    int rate_hz = atoi(args->tokens[5]);
+    cli_assert(nbytes > 0 && rate_hz > 0, usage);
+
+    if (i2c_stream_running()) {
+        log_error("Stream is already running. Stop it first with `i2c stream stop`.");
+        return;
+    }
+    if (!i2c_stream_start(device_address, reg, nbytes, rate_hz)) {
+        log_error("Cannot stream more than " xstr(I2C_STREAM_NBYTES_MAX) " bytes per sample or faster than " xstr(I2C_STREAM_RATE_MAX) " Hz");
+    }
+}
+
 /** `i2c` command handler. */
 static void i2c_cmd_handler(const cmd_args_t *args) {
     cli_assert(args->count >= 2, usage);
@@ -318,6 +878,14 @@ static void i2c_cmd_handler(const cmd_args_t *args) {
         i2c_init(args);
     } else if (!strcmp(args->tokens[1], "slave")) {
         i2c_slave(args);
+    } else if (!strcmp(args->tokens[1], "scan")) {
+        i2c_scan(args);
+    } else if (!strcmp(args->tokens[1], "cache")) {
+        i2c_cache(args);
+    } else if (!strcmp(args->tokens[1], "stream")) {
+        i2c_stream(args);
+    } else if (!strcmp(args->tokens[1], "batch")) {
+        i2c_batch(args);
     } else {
         cli_assert(false, usage);
     }
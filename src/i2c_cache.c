@@ -0,0 +1,221 @@
+#include <string.h>
+#include "i2c_cache.h"
+
+/** Amount of register entries. Must be a power of 2. */
+#define CACHE_ENTRIES 64
+/** Amount of devices with a default policy. */
+#define CACHE_DEVICES 8
+
+/** Register entry flags. */
+enum {
+    /** The entry is in use. */
+    ENTRY_USED = 1 << 0,
+    /** The entry holds a valid value. */
+    ENTRY_VALID = 1 << 1,
+    /** The entry overrides the device policy. */
+    ENTRY_POLICY = 1 << 2,
+    /** The register is cacheable (only meaningful with ENTRY_POLICY). */
+    ENTRY_CACHEABLE = 1 << 3,
+};
+
+/** Register entry. */
+typedef struct {
+    /** 7-bit device address. */
+    uint8_t address;
+    /** Register address. */
+    uint8_t reg;
+    /** Cached value (only meaningful with ENTRY_VALID). */
+    uint8_t value;
+    /** Entry flags. */
+    uint8_t flags;
+} cache_entry_t;
+
+/** Default policy of a device. */
+typedef struct {
+    /** True if the slot is in use. */
+    bool used;
+    /** 7-bit device address. */
+    uint8_t address;
+    /** True if the device registers are cacheable by default. */
+    bool cacheable;
+} cache_device_t;
+
+/** Register entries, in an open addressing hash table. */
+static cache_entry_t entries[CACHE_ENTRIES];
+/** Device policies. */
+static cache_device_t devices[CACHE_DEVICES];
+/** Statistics. */
+static i2c_cache_stats_t stats;
+
+/**
+ * Find the entry for a register.
+ *
+ * \param create If true and the entry does not exist, create it.
+ *
+ * \return the entry, or NULL if not found (or the table is full).
+ */
+static cache_entry_t *find_entry(uint8_t address, uint8_t reg, bool create) {
+    unsigned start = (address * 31u + reg) & (CACHE_ENTRIES - 1);
+    for (unsigned i = 0; i < CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &entries[(start + i) & (CACHE_ENTRIES - 1)];
+        if (!(e->flags & ENTRY_USED)) {
+            if (!create) {
+                return NULL;
+            }
+            e->address = address;
+            e->reg = reg;
+            e->flags = ENTRY_USED;
+            return e;
+        }
+        if (e->address == address && e->reg == reg) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/** Find the policy slot of a device, or a free one if create is true. */
+static cache_device_t *find_device(uint8_t address, bool create) {
+    cache_device_t *free_slot = NULL;
+    for (int i = 0; i < CACHE_DEVICES; i++) {
+        if (devices[i].used && devices[i].address == address) {
+            return &devices[i];
+        }
+        if (!devices[i].used && !free_slot) {
+            free_slot = &devices[i];
+        }
+    }
+    if (create && free_slot) {
+        free_slot->used = true;
+        free_slot->address = address;
+        return free_slot;
+    }
+    return NULL;
+}
+
+/** Return true if the register is cacheable, according to its own or its device policy. */
+static bool is_cacheable(uint8_t address, uint8_t reg, const cache_entry_t *e) {
+    if (e && (e->flags & ENTRY_POLICY)) {
+        return e->flags & ENTRY_CACHEABLE;
+    }
+    cache_device_t *d = find_device(address, false);
+    return d && d->cacheable;
+}
+
+/** Return true if all nbytes registers starting at reg are cacheable. */
+static bool all_cacheable(uint8_t address, uint8_t reg, size_t nbytes) {
+    for (size_t i = 0; i < nbytes; i++) {
+        uint8_t r = reg + i;
+        if (!is_cacheable(address, r, find_entry(address, r, false))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool i2c_cache_set_policy(uint8_t address, int reg, bool cacheable) {
+    if (reg < 0) {
+        cache_device_t *d = find_device(address, true);
+        if (!d) {
+            return false;
+        }
+        d->cacheable = cacheable;
+    } else {
+        cache_entry_t *e = find_entry(address, reg, true);
+        if (!e) {
+            return false;
+        }
+        e->flags |= ENTRY_POLICY;
+        if (cacheable) {
+            e->flags |= ENTRY_CACHEABLE;
+        } else {
+            e->flags &= ~ENTRY_CACHEABLE;
+        }
+    }
+    // values cached under the previous policy may be stale
+    i2c_cache_invalidate();
+    return true;
+}
+
+bool i2c_cache_read(uint8_t address, uint8_t reg, uint8_t data[], size_t nbytes) {
+    if (!all_cacheable(address, reg, nbytes)) {
+        return false;
+    }
+    for (size_t i = 0; i < nbytes; i++) {
+        cache_entry_t *e = find_entry(address, reg + i, false);
+        if (!e || !(e->flags & ENTRY_VALID)) {
+            stats.read_misses++;
+            return false;
+        }
+        data[i] = e->value;
+    }
+    stats.read_hits++;
+    return true;
+}
+
+bool i2c_cache_write(uint8_t address, uint8_t reg, const uint8_t data[], size_t nbytes) {
+    if (!all_cacheable(address, reg, nbytes)) {
+        return false;
+    }
+    for (size_t i = 0; i < nbytes; i++) {
+        cache_entry_t *e = find_entry(address, reg + i, false);
+        if (!e || !(e->flags & ENTRY_VALID) || e->value != data[i]) {
+            stats.write_misses++;
+            return false;
+        }
+    }
+    stats.write_hits++;
+    return true;
+}
+
+void i2c_cache_store(uint8_t address, uint8_t reg, const uint8_t data[], size_t nbytes) {
+    for (size_t i = 0; i < nbytes; i++) {
+        uint8_t r = reg + i;
+        cache_entry_t *e = find_entry(address, r, false);
+        if (!is_cacheable(address, r, e)) {
+            continue;
+        }
+        if (!e) {
+            e = find_entry(address, r, true);
+            if (!e) {
+                stats.full++;
+                continue;
+            }
+        }
+        e->value = data[i];
+        e->flags |= ENTRY_VALID;
+    }
+}
+
+void i2c_cache_invalidate_range(uint8_t address, uint8_t reg, size_t nbytes) {
+    for (size_t i = 0; i < nbytes; i++) {
+        cache_entry_t *e = find_entry(address, reg + i, false);
+        if (e) {
+            e->flags &= ~ENTRY_VALID;
+        }
+    }
+}
+
+void i2c_cache_invalidate() {
+    // entries cannot be removed one by one from the open addressing table, so rebuild it
+    // keeping only the register policies
+    static cache_entry_t old[CACHE_ENTRIES];
+    memcpy(old, entries, sizeof(entries));
+    memset(entries, 0, sizeof(entries));
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        if (old[i].flags & ENTRY_POLICY) {
+            cache_entry_t *e = find_entry(old[i].address, old[i].reg, true);
+            e->flags = old[i].flags & ~ENTRY_VALID;
+        }
+    }
+}
+
+void i2c_cache_reset() {
+    memset(entries, 0, sizeof(entries));
+    memset(devices, 0, sizeof(devices));
+    memset(&stats, 0, sizeof(stats));
+}
+
+const i2c_cache_stats_t *i2c_cache_stats() {
+    return &stats;
+}
@@ -0,0 +1,231 @@
+#include "i2c_engine.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** I2C peripheral driven by the engine. */
+#define I2C_REGS LPC_I2C0
+/** IRQ of the I2C peripheral driven by the engine. */
+#define I2C_IRQN I2C0_IRQn
+
+/** Master mode status codes (STAT register). */
+enum {
+    I2C_STAT_START = 0x08,
+    I2C_STAT_REPEATED_START = 0x10,
+    I2C_STAT_SLA_W_ACK = 0x18,
+    I2C_STAT_SLA_W_NACK = 0x20,
+    I2C_STAT_DATA_TX_ACK = 0x28,
+    I2C_STAT_DATA_TX_NACK = 0x30,
+    I2C_STAT_ARBITRATION_LOST = 0x38,
+    I2C_STAT_SLA_R_ACK = 0x40,
+    I2C_STAT_SLA_R_NACK = 0x48,
+    I2C_STAT_DATA_RX_ACK = 0x50,
+    I2C_STAT_DATA_RX_NACK = 0x58,
+};
+
+/** Transaction in progress, or NULL if idle. */
+static i2c_xfer_t *volatile current;
+
+/**
+ * True if the last transaction did not end with a stop condition. In that case SI is
+ * left set (the bus is stretched) until the next transaction sends a repeated start.
+ */
+static volatile bool bus_held;
+
+bool i2c_engine_init(uint32_t freq_hz) {
+    i2c_engine_abort();
+
+    // pin and clock configuration
+    if (!i2cInit(I2C0, freq_hz)) {
+        return false;
+    }
+
+    I2C_REGS->CONCLR = I2C_CON_AA | I2C_CON_SI | I2C_CON_STO | I2C_CON_STA;
+    I2C_REGS->CONSET = I2C_CON_I2EN;
+    bus_held = false;
+
+    NVIC_DisableIRQ(I2C_IRQN);
+    NVIC_ClearPendingIRQ(I2C_IRQN);
+    NVIC_SetPriority(I2C_IRQN, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+    return true;
+}
+
+/** Finish the current transaction. Called from the ISR. */
+static void finish(i2c_xfer_status_t status, bool stop, BaseType_t *woken) {
+    i2c_xfer_t *xfer = current;
+
+    if (stop) {
+        I2C_REGS->CONSET = I2C_CON_STO;
+        I2C_REGS->CONCLR = I2C_CON_SI | I2C_CON_AA;
+        bus_held = false;
+    } else {
+        // keep SI set, so that the bus is held until the next transaction starts
+        bus_held = true;
+    }
+    NVIC_DisableIRQ(I2C_IRQN);
+
+    current = NULL;
+    xfer->status = status;
+    if (xfer->on_done) {
+        xfer->on_done(xfer, woken);
+    } else {
+        vTaskNotifyGiveFromISR(xfer->task, woken);
+    }
+}
+
+/** I2C0 ISR: master mode state machine. */
+void I2C0_IRQHandler() {
+    BaseType_t woken = pdFALSE;
+    i2c_xfer_t *xfer = current;
+
+    if (xfer == NULL) {
+        // bus held by a previous transaction; nothing to do until the next one starts
+        NVIC_DisableIRQ(I2C_IRQN);
+        return;
+    }
+
+    switch (I2C_REGS->STAT & 0xf8) {
+    case I2C_STAT_START:
+    case I2C_STAT_REPEATED_START:
+        I2C_REGS->DAT = (xfer->address << 1) | (xfer->reading ? 1 : 0);
+        I2C_REGS->CONCLR = I2C_CON_STA | I2C_CON_SI;
+        break;
+
+    case I2C_STAT_SLA_W_ACK:
+    case I2C_STAT_DATA_TX_ACK:
+        if (xfer->tx_index < xfer->tx_nbytes) {
+            I2C_REGS->DAT = xfer->tx_data[xfer->tx_index++];
+            I2C_REGS->CONCLR = I2C_CON_SI;
+        } else if (xfer->rx_nbytes > 0) {
+            xfer->reading = true;
+            // STO + STA sends a stop condition followed by a start condition
+            I2C_REGS->CONSET = xfer->tx_stop ? (I2C_CON_STO | I2C_CON_STA) : I2C_CON_STA;
+            I2C_REGS->CONCLR = I2C_CON_SI;
+        } else {
+            finish(I2C_XFER_DONE, xfer->tx_stop, &woken);
+        }
+        break;
+
+    case I2C_STAT_SLA_R_ACK:
+        if (xfer->rx_nbytes > 1) {
+            I2C_REGS->CONSET = I2C_CON_AA;
+        } else {
+            I2C_REGS->CONCLR = I2C_CON_AA;
+        }
+        I2C_REGS->CONCLR = I2C_CON_SI;
+        break;
+
+    case I2C_STAT_DATA_RX_ACK:
+        xfer->rx_data[xfer->rx_index++] = I2C_REGS->DAT;
+        if (xfer->rx_nbytes - xfer->rx_index > 1) {
+            I2C_REGS->CONSET = I2C_CON_AA;
+        } else {
+            // NACK the last byte
+            I2C_REGS->CONCLR = I2C_CON_AA;
+        }
+        I2C_REGS->CONCLR = I2C_CON_SI;
+        break;
+
+    case I2C_STAT_DATA_RX_NACK:
+        xfer->rx_data[xfer->rx_index++] = I2C_REGS->DAT;
+        finish(I2C_XFER_DONE, xfer->rx_stop, &woken);
+        break;
+
+    case I2C_STAT_SLA_W_NACK:
+    case I2C_STAT_DATA_TX_NACK:
+    case I2C_STAT_SLA_R_NACK:
+        finish(I2C_XFER_NACK, true, &woken);
+        break;
+
+    case I2C_STAT_ARBITRATION_LOST:
+        // the bus belongs to another master: do not send a stop condition
+        I2C_REGS->CONCLR = I2C_CON_SI;
+        finish(I2C_XFER_ERROR, false, &woken);
+        bus_held = false;
+        break;
+
+    default:
+        finish(I2C_XFER_ERROR, true, &woken);
+        break;
+    }
+
+    portYIELD_FROM_ISR(woken);
+}
+
+bool i2c_engine_start(i2c_xfer_t *xfer) {
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    if (current != NULL) {
+        taskEXIT_CRITICAL_FROM_ISR(saved);
+        return false;
+    }
+
+    xfer->status = I2C_XFER_BUSY;
+    xfer->tx_index = 0;
+    xfer->rx_index = 0;
+    // a transaction with no data sends the address only, as a write
+    xfer->reading = xfer->tx_nbytes == 0 && xfer->rx_nbytes > 0;
+    current = xfer;
+
+    I2C_REGS->CONSET = I2C_CON_STA;
+    if (bus_held) {
+        // clearing SI with STA set sends a repeated start
+        I2C_REGS->CONCLR = I2C_CON_SI;
+        bus_held = false;
+    }
+    NVIC_EnableIRQ(I2C_IRQN);
+
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+    return true;
+}
+
+i2c_xfer_status_t i2c_engine_transfer(i2c_xfer_t *xfer, TickType_t timeout) {
+    xfer->on_done = NULL;
+    xfer->task = xTaskGetCurrentTaskHandle();
+
+    // discard stale notifications
+    ulTaskNotifyTake(pdTRUE, 0);
+
+    // the engine may be busy with a transaction started from an ISR (eg: `i2c stream`)
+    TickType_t start = xTaskGetTickCount();
+    while (!i2c_engine_start(xfer)) {
+        if (xTaskGetTickCount() - start >= timeout) {
+            return I2C_XFER_TIMEOUT;
+        }
+        vTaskDelay(1);
+    }
+
+    while (xfer->status == I2C_XFER_BUSY) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            taskENTER_CRITICAL();
+            if (current == xfer) {
+                i2c_engine_abort();
+                xfer->status = I2C_XFER_TIMEOUT;
+            }
+            taskEXIT_CRITICAL();
+            break;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+    return xfer->status;
+}
+
+void i2c_engine_abort() {
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    NVIC_DisableIRQ(I2C_IRQN);
+    if (current != NULL || bus_held) {
+        I2C_REGS->CONCLR = I2C_CON_STA | I2C_CON_AA;
+        I2C_REGS->CONSET = I2C_CON_STO;
+        I2C_REGS->CONCLR = I2C_CON_SI;
+    }
+    if (current != NULL) {
+        current->status = I2C_XFER_ERROR;
+        current = NULL;
+    }
+    bus_held = false;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+bool i2c_engine_bus_held() {
+    return bus_held;
+}
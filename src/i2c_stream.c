@@ -0,0 +1,180 @@
+#include <string.h>
+#include "i2c_stream.h"
+#include "i2c_engine.h"
+#include "ringbuf.h"
+#include "log.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Size of the stream buffer (bytes). Must be a power of 2. */
+#define STREAM_BUFFER_SIZE 4096
+/** Time (us) a sample transaction may take before it is aborted. */
+#define SAMPLE_TIMEOUT_US 5000
+
+/** Stream state. */
+typedef struct {
+    /** True while sampling. */
+    volatile bool running;
+    /** Register address, sent before each read. */
+    uint8_t reg;
+    /** Sample period (us), used to compute the timestamps. */
+    uint32_t period_us;
+    /** Timestamp of the current period (us since the stream started). */
+    uint32_t timestamp_us;
+    /** Timestamp of the period in which the transaction in progress started. */
+    uint32_t started_us;
+    /** Record being assembled: timestamp followed by the sample. */
+    uint8_t record[I2C_STREAM_RECORD_SIZE(I2C_STREAM_NBYTES_MAX)];
+    /** Size of each record. */
+    size_t record_size;
+    /** Transaction used for every sample. */
+    i2c_xfer_t xfer;
+    /** Statistics. */
+    i2c_stream_stats_t stats;
+} stream_t;
+
+static stream_t stream;
+
+/** Storage for the stream buffer. */
+static uint8_t stream_storage[STREAM_BUFFER_SIZE];
+/** Stream buffer, written by the I2C ISR and read by i2c_stream_read. */
+static ringbuf_t stream_buffer;
+
+/** Sample transaction completion callback. Called from the I2C ISR. */
+static void sample_done(i2c_xfer_t *xfer, BaseType_t *woken) {
+    if (xfer->status != I2C_XFER_DONE) {
+        stream.stats.errors++;
+        LOG(LOG_I2C_STREAM_ERROR, xfer->status);
+        return;
+    }
+    if (ringbuf_put(&stream_buffer, stream.record, stream.record_size)) {
+        stream.stats.samples++;
+    } else {
+        stream.stats.full++;
+    }
+}
+
+/** RIT ISR: start a sample transaction each period. */
+void RIT_IRQHandler() {
+    Chip_RIT_ClearInt(LPC_RITIMER);
+
+    if (!stream.running) {
+        return;
+    }
+    stream.timestamp_us += stream.period_us;
+    if (stream.xfer.status == I2C_XFER_BUSY) {
+        if (stream.timestamp_us - stream.started_us < SAMPLE_TIMEOUT_US) {
+            stream.stats.overruns++;
+            LOG(LOG_I2C_STREAM_OVERRUN, stream.timestamp_us);
+            return;
+        }
+        // stalled (eg: a device holding SCL low): release the bus and go on sampling
+        i2c_engine_abort();
+        stream.xfer.status = I2C_XFER_TIMEOUT;
+        stream.stats.errors++;
+        LOG(LOG_I2C_STREAM_ERROR, I2C_XFER_TIMEOUT);
+    }
+    if (i2c_engine_bus_held()) {
+        // a task is in the middle of a sequence of transactions; a sample now would be
+        // sent with its repeated start
+        stream.stats.overruns++;
+        LOG(LOG_I2C_STREAM_OVERRUN, stream.timestamp_us);
+        return;
+    }
+    memcpy(stream.record, &stream.timestamp_us, sizeof(uint32_t));
+    if (!i2c_engine_start(&stream.xfer)) {
+        // the engine is busy with a transaction started by a task
+        stream.stats.overruns++;
+        LOG(LOG_I2C_STREAM_OVERRUN, stream.timestamp_us);
+        return;
+    }
+    stream.started_us = stream.timestamp_us;
+}
+
+bool i2c_stream_start(uint8_t address, uint8_t reg, size_t nbytes, unsigned rate_hz) {
+    if (stream.running || nbytes == 0 || nbytes > I2C_STREAM_NBYTES_MAX || rate_hz == 0 || rate_hz > I2C_STREAM_RATE_MAX) {
+        return false;
+    }
+
+    ringbuf_init(&stream_buffer, stream_storage, STREAM_BUFFER_SIZE);
+    memset(&stream.stats, 0, sizeof(stream.stats));
+    stream.reg = reg;
+    stream.period_us = 1000000 / rate_hz;
+    stream.timestamp_us = -stream.period_us;
+    stream.record_size = I2C_STREAM_RECORD_SIZE(nbytes);
+    stream.xfer = (i2c_xfer_t) {
+        .address = address,
+        .tx_data = &stream.reg,
+        .tx_nbytes = 1,
+        .tx_stop = false,
+        .rx_data = &stream.record[sizeof(uint32_t)],
+        .rx_nbytes = nbytes,
+        .rx_stop = true,
+        .status = I2C_XFER_DONE,
+        .on_done = sample_done,
+    };
+    stream.running = true;
+
+    Chip_RIT_Init(LPC_RITIMER);
+    Chip_RIT_SetCOMPVAL(LPC_RITIMER, Chip_Clock_GetRate(CLK_MX_RITIMER) / rate_hz);
+    Chip_RIT_EnableCompClear(LPC_RITIMER);
+    Chip_RIT_SetCounter(LPC_RITIMER, 0);
+    NVIC_ClearPendingIRQ(RITIMER_IRQn);
+    NVIC_SetPriority(RITIMER_IRQn, configLIBRARY_LOWEST_INTERRUPT_PRIORITY);
+    NVIC_EnableIRQ(RITIMER_IRQn);
+    Chip_RIT_Enable(LPC_RITIMER);
+    return true;
+}
+
+void i2c_stream_stop() {
+    if (!stream.running) {
+        return;
+    }
+    stream.running = false;
+    NVIC_DisableIRQ(RITIMER_IRQn);
+    Chip_RIT_DeInit(LPC_RITIMER);
+
+    // wait for the last sample transaction, aborting it if it stalled
+    TickType_t start = xTaskGetTickCount();
+    while (stream.xfer.status == I2C_XFER_BUSY && xTaskGetTickCount() - start <= pdMS_TO_TICKS(SAMPLE_TIMEOUT_US / 1000)) {
+        vTaskDelay(1);
+    }
+    taskENTER_CRITICAL();
+    if (stream.xfer.status == I2C_XFER_BUSY) {
+        i2c_engine_abort();
+        stream.xfer.status = I2C_XFER_TIMEOUT;
+        stream.stats.errors++;
+    }
+    taskEXIT_CRITICAL();
+}
+
+bool i2c_stream_running() {
+    return stream.running;
+}
+
+size_t i2c_stream_record_size() {
+    return stream.record_size;
+}
+
+size_t i2c_stream_available() {
+    return stream.record_size ? ringbuf_used(&stream_buffer) / stream.record_size : 0;
+}
+
+size_t i2c_stream_read(uint8_t data[], size_t nbytes) {
+    if (!stream.record_size) {
+        return 0;
+    }
+    size_t records = i2c_stream_available();
+    if (records > nbytes / stream.record_size) {
+        records = nbytes / stream.record_size;
+    }
+    return ringbuf_get(&stream_buffer, data, records * stream.record_size);
+}
+
+i2c_stream_stats_t i2c_stream_stats() {
+    taskENTER_CRITICAL();
+    i2c_stream_stats_t stats = stream.stats;
+    taskEXIT_CRITICAL();
+    return stats;
+}
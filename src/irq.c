@@ -1,26 +1,65 @@
+#include <stdio.h>
 #include <string.h>
 #include "irq.h"
+#include "gpio.h"
 #include "task_priorities.h"
 #include "terminal.h"
+#include "lookup.h"
+#include "log.h"
 #include "sapi.h"
 #include "FreeRTOS.h"
 #include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
+#define str(a) #a
+#define xstr(a) str(a)
+
+/** Default debounce window, in ms. */
+#define IRQ_DEBOUNCE_MS_DEFAULT 20
 
 void irq_usage() {
     terminal_puts(
         "Usage:\r\n"
-        "  irq <channel> <trigger> <raising|falling> <command...>\r\n"
+        "  irq <channel> <trigger> <mode> [debounce <ms>] [once|each] [priority] [quiet] <command...>\r\n"
+        "  irq <channel> <trigger> <mode> [debounce <ms>] fast <action>\r\n"
+        "  irq <channel> stats [reset]\r\n"
         "  irq <channel> disable\r\n"
+        "Channels: 0-7\r\n"
+        "Triggers: TEC1-4, GPIO0-8, LCD1-4, LCDRS, LCDEN\r\n"
+        "Modes:\r\n"
+        "  raising | falling | both: edge sensitive; with `both`, an event reports `both`\r\n"
+        "         if the pin pulsed faster than the interrupt could run\r\n"
+        "  high | low: level sensitive; re-armed after the command runs (no fast actions)\r\n"
+        "Options:\r\n"
+        "  debounce <ms>: ignore edges closer than <ms> to the last accepted one (default: " xstr(IRQ_DEBOUNCE_MS_DEFAULT) ")\r\n"
+        "  once: run the command once per burst of pending events (default)\r\n"
+        "  each: run the command once per accepted event\r\n"
+        "  priority: dispatch this channel's events ahead of the other channels (in arrival\r\n"
+        "            order among the priority channels)\r\n"
+        "  quiet: do not print the banner before the command; the event is still recorded\r\n"
+        "         in the deferred log (see `log`)\r\n"
+        "Fast actions (executed inside the ISR, bypassing the gpio mutex):\r\n"
+        "  set <pin> | clear <pin> | toggle <pin>: write a GPIO output\r\n"
+        "  count: increment the channel counter\r\n"
+        "  stamp: latch the timestamp of the edge\r\n"
         "Examples:\r\n"
         "  irq 0 TEC1 falling echo hello\r\n"
+        "  irq 0 TEC1 falling debounce 50 each echo hello\r\n"
+        "  irq 7 GPIO3 both echo edge\r\n"
+        "  irq 1 TEC2 falling debounce 0 fast toggle LED1\r\n"
+        "  irq 1 stats\r\n"
         "  irq 0 disable\r\n"
     );
 }
 
-/** GPIO port description and state. */
+/** GPIO pin that can be used as an interrupt trigger. */
 typedef struct {
     /** GPIO port name. */
-    char *name;
+    const char *name;
+    /** sAPI pin, used to configure it as input. */
+    gpioMap_t gpio;
 
     /** Port for interrupt handler. */
     uint8_t port;
@@ -28,13 +67,40 @@ typedef struct {
     uint8_t pin;
 } gpio_trigger_t;
 
-/** List of supported GPIO ports. */
-static gpio_trigger_t triggers[] = {
-    {"TEC1", 0, 4},
-    {"TEC2", 0, 8},
-    {"TEC3", 0, 9},
-    {"TEC4", 1, 9},
-    {0},
+/** Utility macro to initialize the triggers list. */
+#define MAKE_TRIGGER(gpio_port, gpio_port_num, gpio_pin_num) { \
+    .name = #gpio_port, \
+    .gpio = gpio_port, \
+    .port = gpio_port_num, \
+    .pin = gpio_pin_num, \
+}
+
+/**
+ * List of supported GPIO pins (EDU-CIAA-NXP), with their GPIO port and pin numbers, sorted
+ * by name for `LOOKUP`.
+ */
+static const gpio_trigger_t triggers[] = {
+    MAKE_TRIGGER(GPIO0, 3, 0),
+    MAKE_TRIGGER(GPIO1, 3, 3),
+    MAKE_TRIGGER(GPIO2, 3, 4),
+    MAKE_TRIGGER(GPIO3, 5, 15),
+    MAKE_TRIGGER(GPIO4, 5, 16),
+    MAKE_TRIGGER(GPIO5, 3, 5),
+    MAKE_TRIGGER(GPIO6, 3, 6),
+    MAKE_TRIGGER(GPIO7, 3, 7),
+    MAKE_TRIGGER(GPIO8, 2, 8),
+
+    MAKE_TRIGGER(LCD1, 2, 4),
+    MAKE_TRIGGER(LCD2, 2, 5),
+    MAKE_TRIGGER(LCD3, 2, 6),
+    MAKE_TRIGGER(LCD4, 5, 14),
+    MAKE_TRIGGER(LCDEN, 5, 13),
+    MAKE_TRIGGER(LCDRS, 5, 12),
+
+    MAKE_TRIGGER(TEC1, 0, 4),
+    MAKE_TRIGGER(TEC2, 0, 8),
+    MAKE_TRIGGER(TEC3, 0, 9),
+    MAKE_TRIGGER(TEC4, 1, 9),
 };
 
 /**
@@ -42,17 +108,30 @@ static gpio_trigger_t triggers[] = {
  *
  * \return the trigger, or NULL if not found.
  */
-static gpio_trigger_t *find_trigger(const char *name) {
-    for (gpio_trigger_t *t = triggers; t->name; t++) {
-        if (!strcmp(t->name, name)) {
-            return t;
-        }
-    }
-    return NULL;
+static const gpio_trigger_t *find_trigger(const char *name) {
+    return LOOKUP(triggers, name);
 }
 
-/** GPIO edge trigger type. */
-typedef enum { RAISING, FALLING } edge_t;
+bool irq_tables_sorted() {
+    return LOOKUP_SORTED(triggers);
+}
+
+/** GPIO trigger type: edge or level sensitive. */
+typedef enum { RAISING, FALLING, BOTH, LEVEL_HIGH, LEVEL_LOW } edge_t;
+
+/** Tokens accepted for each trigger type. */
+static const char *edge_tokens[] = {
+    [RAISING] = "raising",
+    [FALLING] = "falling",
+    [BOTH] = "both",
+    [LEVEL_HIGH] = "high",
+    [LEVEL_LOW] = "low",
+};
+
+/** Return true if the trigger type is level sensitive. */
+static bool is_level(edge_t edge) {
+    return edge == LEVEL_HIGH || edge == LEVEL_LOW;
+}
 
 /** Disable the GPIO IRQ. */
 static void disable_irq(uint8_t irq_channel)
@@ -61,17 +140,37 @@ static void disable_irq(uint8_t irq_channel)
     NVIC_DisableIRQ(PIN_INT0_IRQn + irq_channel);
 }
 
-/** Enable the GPIO IRQ with the given trigger. */
-static void enable_irq(uint8_t irq_channel, gpio_trigger_t *trigger, edge_t edge)
+/**
+ * Enable the GPIO IRQ with the given trigger.
+ *
+ * In level mode, IENR enables the interrupt and IENF selects the active level.
+ */
+static void enable_irq(uint8_t irq_channel, const gpio_trigger_t *trigger, edge_t edge)
 {
+   gpioInit(trigger->gpio, GPIO_INPUT);
    Chip_SCU_GPIOIntPinSel(irq_channel, trigger->port, trigger->pin);
    Chip_PININT_ClearIntStatus(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
-   Chip_PININT_SetPinModeEdge(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
 
-   if (edge == RAISING) {
+   if (is_level(edge)) {
+      Chip_PININT_SetPinModeLevel(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
       Chip_PININT_EnableIntHigh(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      if (edge == LEVEL_HIGH) {
+         Chip_PININT_EnableIntLow(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      } else {
+         Chip_PININT_DisableIntLow(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      }
    } else {
-      Chip_PININT_EnableIntLow(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      Chip_PININT_SetPinModeEdge(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      if (edge == RAISING || edge == BOTH) {
+         Chip_PININT_EnableIntHigh(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      } else {
+         Chip_PININT_DisableIntHigh(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      }
+      if (edge == FALLING || edge == BOTH) {
+         Chip_PININT_EnableIntLow(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      } else {
+         Chip_PININT_DisableIntLow(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+      }
    }
 
    NVIC_ClearPendingIRQ(PIN_INT0_IRQn + irq_channel);
@@ -81,92 +180,510 @@ static void enable_irq(uint8_t irq_channel, gpio_trigger_t *trigger, edge_t edge
 
 /** Parse the edge trigger token. */
 static bool parse_edge(const char *s, edge_t *out) {
-    if (!strcmp(s, "falling")) {
-        *out = FALLING;
+    for (edge_t edge = RAISING; edge <= LEVEL_LOW; edge++) {
+        if (!strcmp(s, edge_tokens[edge])) {
+            *out = edge;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Parse the coalescing policy token.
+ *
+ * \param s The input string.
+ * \param out Output variable: true if pending events are merged into a single execution.
+ *
+ * \return false if the string is not a coalescing policy.
+ */
+static bool parse_coalesce(const char *s, bool *out) {
+    if (!strcmp(s, "once")) {
+        *out = true;
         return true;
     }
-    if (!strcmp(s, "raising")) {
-        *out = RAISING;
+    if (!strcmp(s, "each")) {
+        *out = false;
+        return true;
+    }
+    return false;
+}
+
+/** Action executed directly inside the ISR, instead of dispatching a command. */
+typedef enum {
+    FAST_NONE,
+    FAST_SET,
+    FAST_CLEAR,
+    FAST_TOGGLE,
+    FAST_COUNT,
+    FAST_STAMP,
+} fast_action_t;
+
+/**
+ * Parse the `fast <action>` section of the command line.
+ *
+ * \param args The tokenized comand line arguments
+ * \param token_index Index of the token following `fast`.
+ * \param action (out) The parsed action.
+ * \param pin (out) The GPIO pin, for the set/clear/toggle actions.
+ *
+ * \return false if the section cannot be parsed successfully.
+ */
+static bool parse_fast_action(const cmd_args_t *args, unsigned token_index, fast_action_t *action, gpioMap_t *pin) {
+    static const struct {
+        const char *name;
+        fast_action_t action;
+        bool has_pin;
+    } actions[] = {
+        {"set", FAST_SET, true},
+        {"clear", FAST_CLEAR, true},
+        {"toggle", FAST_TOGGLE, true},
+        {"count", FAST_COUNT, false},
+        {"stamp", FAST_STAMP, false},
+    };
+    if (token_index >= args->count) {
+        return false;
+    }
+    for (int i = 0; i < sizeof(actions) / sizeof(actions[0]); i++) {
+        if (strcmp(actions[i].name, args->tokens[token_index])) {
+            continue;
+        }
+        if (args->count != token_index + (actions[i].has_pin ? 2 : 1)) {
+            return false;
+        }
+        if (actions[i].has_pin && !gpio_find_pin(args->tokens[token_index + 1], pin)) {
+            return false;
+        }
+        *action = actions[i].action;
         return true;
     }
     return false;
 }
 
 /** Amount of supported IRQ channels */
-#define IRQ_CHANNELS 4
+#define IRQ_CHANNELS 8
 
-/** State of an IRQ channel. */
+/**
+ * List of IRQ channels, used to generate one `GPIO<n>_IRQHandler` per channel.
+ * Must have IRQ_CHANNELS entries.
+ */
+#define IRQ_CHANNEL_LIST(X) X(0) X(1) X(2) X(3) X(4) X(5) X(6) X(7)
+
+/** Capacity of each event queue (one for the priority channels, one for the rest). */
+#define IRQ_QUEUE_CAPACITY 16
+
+/** Event record posted by the ISR to the dispatcher task. */
 typedef struct {
-    /** IRQ channel number (same as index in settings array). */
+    /** IRQ channel that triggered the event. */
     uint8_t irq_channel;
-    /** RTOS task handle for irq_subcommand_task. */
-    TaskHandle_t task_handle;
-    /** RTOS task name for irq_subcommand_task. */
-    TaskHandle_t task_name;
+    /** Edge that triggered the event (RAISING or FALLING), or the level (LEVEL_HIGH or LEVEL_LOW). */
+    uint8_t edge;
+    /** Tick count at the time of the edge. */
+    TickType_t tick;
+    /** Cycle counter at ISR entry. */
+    uint32_t cycles;
+    /** Configuration of the channel when the event was posted (see irq_settings_t). */
+    uint8_t generation;
+} irq_event_t;
+
+/**
+ * Amount of buckets in the latency histogram.
+ *
+ * Bucket 0 counts latencies below 1 us, bucket n counts latencies in [2^(n-1), 2^n) us,
+ * and the last bucket also counts everything above.
+ */
+#define LATENCY_BUCKETS 12
+
+/** Latency and throughput statistics of a channel. Latencies are in CPU cycles. */
+typedef struct {
+    /** Accepted events (fast action runs or events posted to the queue). */
+    uint32_t events;
+    /** Total events merged by debouncing or coalescing. */
+    uint32_t merged;
+    /** Total events lost because the queue was full. */
+    uint32_t lost;
+    /** Maximum amount of queued events seen when posting an event of this channel. */
+    uint32_t depth_max;
+    /** Amount of latency measurements. */
+    uint32_t count;
+    /** Last latency measurement. */
+    uint32_t last;
+    /** Minimum latency measurement. */
+    uint32_t min;
+    /** Maximum latency measurement. */
+    uint32_t max;
+    /** Latency histogram. */
+    uint32_t histogram[LATENCY_BUCKETS];
+} irq_stats_t;
+
+/** State of an IRQ channel. */
+typedef struct {
+    /** True if the channel is enabled. */
+    volatile bool active;
     /** Command to execute when IRQ is triggered. */
     cmd_args_t subcmd;
+    /** Output sink for the banner and the command, inherited from the task that ran `irq`. */
+    terminal_sink_t *sink;
+    /** Edges closer than this amount of ticks to the last accepted edge are ignored. */
+    TickType_t debounce_ticks;
+    /** If true, all pending events are merged into a single command execution. */
+    bool coalesce;
+    /** If true, events are posted to irq_priority_queue, drained before irq_queue. */
+    bool priority;
+    /** If true, the banner is not printed; the event is only recorded in the deferred log. */
+    bool quiet;
+    /** Configured trigger type. */
+    edge_t edge;
+    /** Configured trigger pin. */
+    const gpio_trigger_t *trigger;
+    /** Action executed inside the ISR, or FAST_NONE to dispatch `subcmd`. */
+    fast_action_t fast_action;
+    /** GPIO pin for the set/clear/toggle fast actions. */
+    gpioMap_t fast_pin;
+    /** Counter incremented by the `count` fast action. */
+    volatile uint32_t counter;
+    /** Tick count latched by the `stamp` fast action. */
+    volatile TickType_t stamp_tick;
+    /** Cycle counter latched by the `stamp` fast action. */
+    volatile uint32_t stamp_cycles;
+    /** Statistics. Latency is measured from ISR entry until the fast action runs, or the dispatcher task picks up the event. */
+    irq_stats_t stats;
+    /** Tick count of the last accepted edge (written by the ISR). */
+    TickType_t last_edge_tick;
+    /** True while an event for this channel is waiting in the queue (coalescing mode only). */
+    volatile bool queued;
+    /** Events merged since the last command execution (written by the ISR). */
+    volatile uint32_t merged;
+    /** Events lost since the last command execution because the queue was full. */
+    volatile uint32_t lost;
+    /** Incremented on each configuration, so that the events posted before are dropped. */
+    uint8_t generation;
+    /** True while the dispatcher task executes subcmd; the channel cannot be reconfigured. */
+    volatile bool running;
 } irq_settings_t;
 
 /** `irq` global state. */
-static irq_settings_t settings[IRQ_CHANNELS] = {
-    {.irq_channel = 0, .task_name = "irq0"},
-    {.irq_channel = 1, .task_name = "irq1"},
-    {.irq_channel = 2, .task_name = "irq2"},
-    {.irq_channel = 3, .task_name = "irq3"},
-};
+static irq_settings_t settings[IRQ_CHANNELS];
+
+/** Event queue, from the ISRs to irq_dispatcher_task. */
+static QueueHandle_t irq_queue;
+/** Event queue of the `priority` channels, drained before irq_queue. */
+static QueueHandle_t irq_priority_queue;
+/** Amount of events in both queues, so that the dispatcher can wait for either one. */
+static SemaphoreHandle_t irq_pending;
+
+/** RTOS task handle for irq_dispatcher_task. */
+static TaskHandle_t dispatcher_handle;
+
+/** Convert a measurement from CPU cycles to microseconds. */
+static uint32_t cycles_to_us(uint32_t cycles) {
+    return cycles / (SystemCoreClock / 1000000);
+}
+
+/** Return the histogram bucket for a latency measurement, in microseconds. */
+static unsigned latency_bucket(uint32_t us) {
+    unsigned bucket = us ? 32 - __builtin_clz(us) : 0;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+/** Record a latency measurement. Must be called from the ISR or inside a critical section. */
+static void record_latency(irq_stats_t *stats, uint32_t cycles) {
+    if (stats->count == 0 || cycles < stats->min) {
+        stats->min = cycles;
+    }
+    if (cycles > stats->max) {
+        stats->max = cycles;
+    }
+    stats->last = cycles;
+    stats->count++;
+    stats->histogram[latency_bucket(cycles_to_us(cycles))]++;
+}
+
+/** Execute the channel fast action. Called from the ISR. */
+static void run_fast_action(irq_settings_t *s, const irq_event_t *event) {
+    switch (s->fast_action) {
+    case FAST_SET:
+        gpioWrite(s->fast_pin, HIGH);
+        break;
+    case FAST_CLEAR:
+        gpioWrite(s->fast_pin, LOW);
+        break;
+    case FAST_TOGGLE:
+        gpioToggle(s->fast_pin);
+        break;
+    case FAST_COUNT:
+        s->counter++;
+        break;
+    case FAST_STAMP:
+        s->stamp_tick = event->tick;
+        s->stamp_cycles = event->cycles;
+        break;
+    case FAST_NONE:
+        break;
+    }
+    record_latency(&s->stats, cyclesCounterRead() - event->cycles);
+}
 
-/** ISR triggered from the configured GPIO port, that notifies the corresponding RTOS task. */
+/**
+ * ISR triggered from the configured GPIO port, that runs the fast action or posts an
+ * event to the dispatcher task.
+ *
+ * Edges that fall inside the debounce window of the last accepted edge are not posted;
+ * they are only counted as merged. In coalescing mode, an edge that arrives while the
+ * previous event of the channel is still queued is merged as well.
+ *
+ * In level mode the interrupt would fire continuously while the level is held, so the
+ * channel is masked here and re-armed by the dispatcher task once the event is handled.
+ */
 static void handle_irq(uint8_t irq_channel) {
+    uint32_t entry_cycles = cyclesCounterRead();
     BaseType_t context_switch_needed = pdFALSE;
+    irq_settings_t *s = &settings[irq_channel];
 
-    if (settings[irq_channel].task_handle != NULL) {
-        vTaskNotifyGiveFromISR(settings[irq_channel].task_handle, &context_switch_needed);
+    bool level = is_level(s->edge);
+    if (level) {
+        Chip_PININT_DisableIntHigh(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+    }
+
+    if (s->active) {
+        irq_event_t event = {
+            .cycles = entry_cycles,
+            .irq_channel = irq_channel,
+            .edge = s->edge,
+            .tick = xTaskGetTickCountFromISR(),
+            .generation = s->generation,
+        };
+        if (s->edge == BOTH) {
+            // the pin may have changed again since the edge; the latches record what happened
+            bool rise = Chip_PININT_GetRiseStates(LPC_GPIO_PIN_INT) & PININTCH(irq_channel);
+            bool fall = Chip_PININT_GetFallStates(LPC_GPIO_PIN_INT) & PININTCH(irq_channel);
+            Chip_PININT_ClearRiseStates(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+            Chip_PININT_ClearFallStates(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+            // both latched: a pulse shorter than the interrupt latency
+            event.edge = rise && fall ? BOTH : rise ? RAISING : FALLING;
+        }
+        if (!level && (event.tick - s->last_edge_tick < s->debounce_ticks || (s->coalesce && s->queued))) {
+            s->merged++;
+            s->stats.merged++;
+        } else if (s->fast_action != FAST_NONE) {
+            s->last_edge_tick = event.tick;
+            s->stats.events++;
+            run_fast_action(s, &event);
+        } else {
+            s->last_edge_tick = event.tick;
+            s->stats.events++;
+            // a separate queue, rather than the front of irq_queue, keeps the priority
+            // events in arrival order among themselves
+            QueueHandle_t queue = s->priority ? irq_priority_queue : irq_queue;
+            uint32_t depth = uxQueueMessagesWaitingFromISR(queue);
+            if (depth > s->stats.depth_max) {
+                s->stats.depth_max = depth;
+            }
+            if (xQueueSendToBackFromISR(queue, &event, &context_switch_needed) == pdTRUE) {
+                xSemaphoreGiveFromISR(irq_pending, &context_switch_needed);
+                s->queued = true;
+            } else {
+                s->lost++;
+                s->stats.lost++;
+                LOG(LOG_IRQ_LOST, irq_channel);
+            }
+        }
     }
 
     Chip_PININT_ClearRiseStates(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
     Chip_PININT_ClearFallStates(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
-    Chip_PININT_ClearIntStatus(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+    if (!level) {
+        // in level mode, writing IST toggles the active level instead
+        Chip_PININT_ClearIntStatus(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+    }
 
     portYIELD_FROM_ISR(context_switch_needed);
 }
 
-void GPIO0_IRQHandler()
-{
-    handle_irq(0);
-}
+/** Define the `GPIO<n>_IRQHandler` ISR for IRQ channel n. */
+#define DEFINE_IRQ_HANDLER(n) \
+    void GPIO##n##_IRQHandler() \
+    { \
+        handle_irq(n); \
+    }
 
-void GPIO1_IRQHandler()
-{
-    handle_irq(1);
+IRQ_CHANNEL_LIST(DEFINE_IRQ_HANDLER)
+
+/** Print a number to the terminal. */
+static void print_number(const char *prefix, unsigned long n) {
+    char s[12];
+    snprintf(s, sizeof(s), "%lu", n);
+    terminal_puts(prefix);
+    terminal_puts(s);
 }
 
-void GPIO2_IRQHandler()
-{
-    handle_irq(2);
+/** Re-arm the level sensitive channels that were masked by the ISR and have no queued event. */
+static void rearm_level_channels() {
+    for (uint8_t irq_channel = 0; irq_channel < IRQ_CHANNELS; irq_channel++) {
+        irq_settings_t *s = &settings[irq_channel];
+        if (s->active && is_level(s->edge) && !s->queued) {
+            Chip_PININT_EnableIntHigh(LPC_GPIO_PIN_INT, PININTCH(irq_channel));
+        }
+    }
 }
 
-void GPIO3_IRQHandler()
-{
-    handle_irq(3);
+/** Print the line that announces the execution of the command of a channel. */
+static void print_banner(const irq_settings_t *s, const irq_event_t *event, uint32_t merged, uint32_t lost) {
+    print_number("[", event->tick);
+    print_number(" ms] GPIO triggered interrupt on channel ", event->irq_channel);
+    terminal_puts(" (");
+    terminal_puts(edge_tokens[event->edge]);
+    if (merged > 0) {
+        print_number(", events merged: ", merged);
+    }
+    if (lost > 0) {
+        print_number(", events lost: ", lost);
+    }
+    terminal_puts("); executing `");
+    terminal_puts(s->subcmd.tokens[0]);
+    terminal_println("` command.");
 }
 
 /**
- * FreeRTOS task that waits for the configured GPIO port to trigger the interrupt, and then
- * execute the configured subcommand.
+ * FreeRTOS task that waits for events posted by the GPIO ISRs, and executes the
+ * configured subcommand of each channel, in arrival order (the events of the `priority`
+ * channels first).
  */
-static void irq_subcommand_task(void *param) {
-    uint8_t irq_channel = ((irq_settings_t *)param)->irq_channel;
+static void irq_dispatcher_task(void *param) {
+    static terminal_limiter_t limiter;
+    terminal_set_background(&limiter);
+
     while (1) {
-        ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+        irq_event_t event;
+        if (!xSemaphoreTake(irq_pending, portMAX_DELAY)) {
+            continue;
+        }
+        if (!xQueueReceive(irq_priority_queue, &event, 0) && !xQueueReceive(irq_queue, &event, 0)) {
+            continue;
+        }
+        uint32_t latency = cyclesCounterRead() - event.cycles;
+        irq_settings_t *s = &settings[event.irq_channel];
+
+        taskENTER_CRITICAL();
+        // the channel was disabled, or reconfigured, after the event was posted
+        bool active = s->active && event.generation == s->generation;
+        uint32_t merged = 0;
+        uint32_t lost = 0;
+        if (active) {
+            record_latency(&s->stats, latency);
+            merged = s->merged;
+            lost = s->lost;
+            s->queued = false;
+            s->merged = 0;
+            s->lost = 0;
+            s->running = true;
+        }
+        taskEXIT_CRITICAL();
 
-        terminal_puts("GPIO triggered interrupt; executing `");
-        terminal_puts(settings[irq_channel].subcmd.tokens[0]);
-        terminal_println("` command.");
+        if (!active) {
+            rearm_level_channels();
+            continue;
+        }
 
-        cli_exec_command(&settings[irq_channel].subcmd);
+        LOG(LOG_IRQ_EVENT, event.irq_channel, event.edge, event.tick, merged);
+        terminal_set_sink(s->sink);
+        if (!s->quiet) {
+            print_banner(s, &event, merged, lost);
+        }
+
+        cli_exec_command(&s->subcmd);
+        s->running = false;
+        terminal_set_sink(NULL);
+        rearm_level_channels();
     }
 }
 
+/** Create the event queue and the dispatcher task, if not created yet. */
+static bool irq_dispatcher_init() {
+    if (irq_queue == NULL) {
+        irq_queue = xQueueCreate(IRQ_QUEUE_CAPACITY, sizeof(irq_event_t));
+        irq_priority_queue = xQueueCreate(IRQ_QUEUE_CAPACITY, sizeof(irq_event_t));
+        irq_pending = xSemaphoreCreateCounting(2 * IRQ_QUEUE_CAPACITY, 0);
+        if (irq_queue == NULL || irq_priority_queue == NULL || irq_pending == NULL) {
+            log_error("Failed to create queue");
+            return false;
+        }
+    }
+
+    if (dispatcher_handle == NULL) {
+        if (xTaskCreate(
+            irq_dispatcher_task,
+            "irq",
+            configMINIMAL_STACK_SIZE * 2,
+            0,
+            IRQ_TASK_PRIORITY,
+            &dispatcher_handle
+        ) != pdPASS) {
+            log_error("Failed to create task");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/** Print a latency measurement, in cycles and microseconds. */
+static void print_latency(const char *name, uint32_t cycles) {
+    terminal_puts(name);
+    print_number("", cycles);
+    print_number(" cycles (", cycles_to_us(cycles));
+    terminal_println(" us)");
+}
+
+/** `irq <channel> stats` command handler. */
+static void irq_stats_cmd_handler(irq_settings_t *s) {
+    irq_stats_t stats;
+    taskENTER_CRITICAL();
+    stats = s->stats;
+    taskEXIT_CRITICAL();
+
+    terminal_println(s->fast_action != FAST_NONE ? "Path: fast (ISR)" : "Path: task");
+    print_number("Counter: ", s->counter);
+    terminal_println("");
+    print_number("Stamp: ", s->stamp_tick);
+    print_number(" ms, cycle ", s->stamp_cycles);
+    terminal_println("");
+    print_number("Events: ", stats.events);
+    print_number(", merged: ", stats.merged);
+    print_number(", lost: ", stats.lost);
+    terminal_println("");
+    print_number("Max queue depth: ", stats.depth_max);
+    terminal_println("");
+    print_number("Measurements: ", stats.count);
+    terminal_println("");
+    if (stats.count == 0) {
+        return;
+    }
+    print_latency("Latency last: ", stats.last);
+    print_latency("Latency min: ", stats.min);
+    print_latency("Latency max: ", stats.max);
+    terminal_println("Latency histogram:");
+    for (unsigned i = 0; i < LATENCY_BUCKETS; i++) {
+        if (stats.histogram[i] == 0) {
+            continue;
+        }
+        if (i == LATENCY_BUCKETS - 1) {
+            print_number("  >= ", 1UL << (i - 1));
+        } else {
+            print_number("  < ", 1UL << i);
+        }
+        print_number(" us: ", stats.histogram[i]);
+        terminal_println("");
+    }
+}
+
+/** `irq <channel> stats reset` command handler. */
+static void irq_stats_reset_cmd_handler(irq_settings_t *s) {
+    taskENTER_CRITICAL();
+    memset(&s->stats, 0, sizeof(s->stats));
+    taskEXIT_CRITICAL();
+}
+
 /** `irq` command handler function. */
 static void irq_cmd_handler(const cmd_args_t *args) {
     cli_assert(args->count >= 2, irq_usage);
@@ -175,39 +692,96 @@ static void irq_cmd_handler(const cmd_args_t *args) {
     cli_assert(irq_channel >= 0 && irq_channel < IRQ_CHANNELS, irq_usage);
 
     if (args->count == 3 && !strcmp(args->tokens[2], "disable")) {
-        if (settings[irq_channel].task_handle != NULL) {
+        if (settings[irq_channel].active) {
             disable_irq(irq_channel);
-            vTaskDelete(settings[irq_channel].task_handle);
-            settings[irq_channel].task_handle = NULL;
+            settings[irq_channel].active = false;
         }
         return;
     }
 
+    if (args->count == 3 && !strcmp(args->tokens[2], "stats")) {
+        irq_stats_cmd_handler(&settings[irq_channel]);
+        return;
+    }
+
+    if (args->count == 4 && !strcmp(args->tokens[2], "stats") && !strcmp(args->tokens[3], "reset")) {
+        irq_stats_reset_cmd_handler(&settings[irq_channel]);
+        return;
+    }
+
     if (args->count >= 5) {
-        // irq <channel> <trigger> <falling|raising> <command...>
-        if (settings[irq_channel].task_handle != NULL) {
+        // irq <channel> <trigger> <mode> [debounce <ms>] [once|each] [priority] [quiet] <command...>
+        // irq <channel> <trigger> <mode> [debounce <ms>] fast <action>
+        terminal_sink_t *sink = cli_take_redirection();
+        if (settings[irq_channel].active) {
             log_error("Channel is currently active. Disable it first with `irq <channel> disable`.");
             return;
         }
+        if (settings[irq_channel].running) {
+            // the dispatcher task is still executing the previous command of the channel
+            log_error("Channel is still executing its command. Try again when it finishes.");
+            return;
+        }
 
-        gpio_trigger_t *trigger = find_trigger(args->tokens[2]);
+        const gpio_trigger_t *trigger = find_trigger(args->tokens[2]);
         cli_assert(trigger, irq_usage);
 
         edge_t edge;
         cli_assert(parse_edge(args->tokens[3], &edge), irq_usage);
 
-        cli_extract_subcommand(args, 4, &settings[irq_channel].subcmd);
-
-        if (xTaskCreate(
-            irq_subcommand_task,
-            settings[irq_channel].task_name,
-            configMINIMAL_STACK_SIZE * 2,
-            &settings[irq_channel],
-            IRQ_TASK_PRIORITY,
-            &settings[irq_channel].task_handle
-        ) != pdPASS) {
-            log_error("Failed to create task");
+        int debounce_ms = IRQ_DEBOUNCE_MS_DEFAULT;
+        bool coalesce = true;
+        bool priority = false;
+        bool quiet = false;
+        unsigned subcmd_index = 4;
+        while (subcmd_index < args->count) {
+            if (!strcmp(args->tokens[subcmd_index], "debounce") && subcmd_index + 1 < args->count) {
+                debounce_ms = atoi(args->tokens[subcmd_index + 1]);
+                cli_assert(debounce_ms >= 0, irq_usage);
+                subcmd_index += 2;
+            } else if (parse_coalesce(args->tokens[subcmd_index], &coalesce)) {
+                subcmd_index++;
+            } else if (!strcmp(args->tokens[subcmd_index], "priority")) {
+                priority = true;
+                subcmd_index++;
+            } else if (!strcmp(args->tokens[subcmd_index], "quiet")) {
+                quiet = true;
+                subcmd_index++;
+            } else {
+                break;
+            }
+        }
+        cli_assert(subcmd_index < args->count, irq_usage);
+
+        irq_settings_t *s = &settings[irq_channel];
+        if (!strcmp(args->tokens[subcmd_index], "fast")) {
+            // level mode relies on the dispatcher task to re-arm the channel
+            cli_assert(!is_level(edge), irq_usage);
+            cli_assert(parse_fast_action(args, subcmd_index + 1, &s->fast_action, &s->fast_pin), irq_usage);
+        } else {
+            if (!irq_dispatcher_init()) {
+                return;
+            }
+            s->fast_action = FAST_NONE;
+            cli_extract_subcommand(args, subcmd_index, &s->subcmd);
+            s->sink = sink;
         }
+        s->debounce_ticks = pdMS_TO_TICKS(debounce_ms);
+        s->coalesce = coalesce;
+        s->priority = priority;
+        s->quiet = quiet;
+        s->edge = edge;
+        s->trigger = trigger;
+        s->last_edge_tick = xTaskGetTickCount() - s->debounce_ticks;
+        s->queued = false;
+        s->merged = 0;
+        s->lost = 0;
+        s->counter = 0;
+        s->stamp_tick = 0;
+        s->stamp_cycles = 0;
+        memset(&s->stats, 0, sizeof(s->stats));
+        s->generation++;
+        s->active = true;
 
         enable_irq(irq_channel, trigger, edge);
         return;
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <string.h>
+#include "jobs.h"
+#include "log.h"
+#include "task_priorities.h"
+#include "terminal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+/** Amount of worker tasks */
+#define JOB_WORKERS 2
+/** Maximum amount of queued or running jobs */
+#define JOB_MAX 4
+/** Period at which `wait` checks whether its own job was killed (ms) */
+#define JOB_KILL_POLL_MS 50
+
+/** State of a job slot. */
+typedef enum {
+    JOB_FREE,
+    JOB_QUEUED,
+    JOB_RUNNING,
+} job_state_t;
+
+/** A background job. */
+typedef struct {
+    /** Slot state. */
+    job_state_t state;
+    /** Job number, shown to the user. */
+    unsigned id;
+    /** Command to execute, taken from the cli pool. */
+    cmd_args_t *args;
+    /** Output sink inherited from the task that started the job. */
+    terminal_sink_t *sink;
+    /** Set by `kill`. */
+    bool killed;
+    /** Set when the running command saw `killed` (see jobs_killed) and stopped early. */
+    bool stopped;
+    /** Worker task running the job. */
+    TaskHandle_t worker;
+    /** Task blocked in `wait` for this job, or NULL. */
+    TaskHandle_t waiter;
+} job_t;
+
+/** A worker task. */
+typedef struct {
+    /** RTOS task name. */
+    const char *task_name;
+    /** Rate limiter for the output of the jobs run by this worker. */
+    terminal_limiter_t limiter;
+} job_worker_t;
+
+static job_t jobs[JOB_MAX];
+
+static job_worker_t workers[JOB_WORKERS] = {
+    {.task_name = "job0"},
+    {.task_name = "job1"},
+};
+
+/** Jobs waiting for a worker. */
+static QueueHandle_t job_queue;
+
+/** Number of the last job started. */
+static unsigned last_id;
+
+/** Print a job number and a message. */
+static void print_job(const job_t *job, const char *msg) {
+    char s[48];
+    snprintf(s, sizeof(s), "[%u] %s", job->id, msg);
+    terminal_println(s);
+}
+
+/** Release a finished or discarded job, waking up the task waiting for it. */
+static void release_job(job_t *job) {
+    cmd_args_t *args = job->args;
+
+    taskENTER_CRITICAL();
+    TaskHandle_t waiter = job->waiter;
+    job->waiter = NULL;
+    job->state = JOB_FREE;
+    taskEXIT_CRITICAL();
+
+    // only once the slot is free: `jobs` reads the command of the listed jobs
+    cli_args_free(args);
+
+    if (waiter) {
+        xTaskNotifyGive(waiter);
+    }
+}
+
+/** RTOS task that executes the queued jobs, one at a time, in an infinite loop. */
+static void job_worker_task(void *param) {
+    job_worker_t *worker = param;
+    terminal_set_background(&worker->limiter);
+
+    while (1) {
+        job_t *job;
+        if (!xQueueReceive(job_queue, &job, portMAX_DELAY)) {
+            continue;
+        }
+
+        taskENTER_CRITICAL();
+        bool killed = job->killed;
+        if (!killed) {
+            job->state = JOB_RUNNING;
+            job->worker = xTaskGetCurrentTaskHandle();
+        }
+        taskEXIT_CRITICAL();
+
+        terminal_set_sink(job->sink);
+        if (!killed) {
+            LOG(LOG_JOB_START, job->id);
+            cli_exec_command(job->args);
+            LOG(LOG_JOB_END, job->id, job->stopped);
+            print_job(job, job->stopped ? "Killed" : "Done");
+        } else {
+            print_job(job, "Killed");
+        }
+        terminal_set_sink(NULL);
+        release_job(job);
+    }
+}
+
+bool jobs_init() {
+    job_queue = xQueueCreate(JOB_MAX, sizeof(job_t *));
+    if (job_queue == NULL) {
+        log_error("Failed to create job queue");
+        return false;
+    }
+
+    for (int i = 0; i < JOB_WORKERS; i++) {
+        if (xTaskCreate(
+            job_worker_task,
+            workers[i].task_name,
+            configMINIMAL_STACK_SIZE * 2,
+            &workers[i],
+            JOB_TASK_PRIORITY,
+            0
+        ) != pdPASS) {
+            log_error("Failed to create task");
+            return false;
+        }
+    }
+    return true;
+}
+
+void jobs_submit(const cmd_args_t *args, int ntokens) {
+    terminal_sink_t *sink = cli_take_redirection();
+    cmd_args_t *cmd = cli_args_alloc();
+    if (cmd == NULL) {
+        log_error("Out of command buffers; see `pool`");
+        return;
+    }
+    cli_extract_subcommand(args, 0, cmd);
+    cmd->count = ntokens;
+
+    job_t *job = NULL;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < JOB_MAX; i++) {
+        if (jobs[i].state == JOB_FREE) {
+            job = &jobs[i];
+            *job = (job_t) {
+                .state = JOB_QUEUED,
+                .id = ++last_id,
+                .args = cmd,
+            };
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    if (job == NULL) {
+        cli_args_free(cmd);
+        log_error("Too many jobs. Use `wait` or `kill`.");
+        return;
+    }
+    job->sink = sink;
+    // before queueing it: a worker may run and release the job right away
+    print_job(job, cmd->tokens[0]);
+
+    // there is room in the queue for every slot
+    xQueueSendToBack(job_queue, &job, 0);
+}
+
+bool jobs_killed() {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    bool killed = false;
+    taskENTER_CRITICAL();
+    for (int i = 0; i < JOB_MAX; i++) {
+        job_t *job = &jobs[i];
+        if (job->state == JOB_RUNNING && job->worker == self && job->killed) {
+            job->stopped = true;
+            killed = true;
+        }
+    }
+    taskEXIT_CRITICAL();
+    return killed;
+}
+
+/**
+ * Find an active job by number. Must be called inside a critical section, since the slot
+ * may be released and reused at any time.
+ *
+ * \return NULL if not found.
+ */
+static job_t *find_job(unsigned id) {
+    for (int i = 0; i < JOB_MAX; i++) {
+        if (jobs[i].state != JOB_FREE && jobs[i].id == id) {
+            return &jobs[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Block until the job with the given number finishes (or its slot is reused), or until
+ * the job running this `wait` is killed.
+ *
+ * \return false if killed.
+ */
+static bool wait_job(job_t *job, unsigned id) {
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    while (1) {
+        taskENTER_CRITICAL();
+        bool finished = job->state == JOB_FREE || job->id != id;
+        if (!finished) {
+            job->waiter = self;
+        }
+        taskEXIT_CRITICAL();
+        if (finished) {
+            return true;
+        }
+        if (ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(JOB_KILL_POLL_MS)) || !jobs_killed()) {
+            continue;
+        }
+
+        taskENTER_CRITICAL();
+        bool notifying = job->waiter != self;
+        if (!notifying) {
+            job->waiter = NULL;
+        }
+        taskEXIT_CRITICAL();
+        if (notifying) {
+            // release_job already took the waiter: consume its notification, so that it
+            // does not wake up the next blocking call of this task
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+        return false;
+    }
+}
+
+/** Print the `jobs`, `wait` and `kill` commands usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage:\r\n"
+        "  <command...> &\r\n"
+        "      Run the command on a background worker task, keeping the command line\r\n"
+        "      available. Its output is sent when the command line is idle.\r\n"
+        "  jobs\r\n"
+        "      List the queued and running jobs.\r\n"
+        "  wait [<job>]\r\n"
+        "      Wait until the job (or all jobs) finish.\r\n"
+        "  kill <job>\r\n"
+        "      Discard a queued job, or stop a running one at its next check (`sleep`,\r\n"
+        "      `wait`, `spi bench`). Other commands run to completion, and then the job\r\n"
+        "      is reported as done.\r\n"
+        "Example:\r\n"
+        "  $ sleep 5000 &\r\n"
+        "  [1] sleep\r\n"
+        "  $ kill 1\r\n"
+        "  [1] Killed\r\n"
+    );
+}
+
+/** `jobs` command handler function. */
+static void jobs_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count == 1, usage);
+    char name[CLI_LINE_MAX];
+    char s[sizeof(name) + 16];
+    for (int i = 0; i < JOB_MAX; i++) {
+        // the command buffer is freed along with the slot, so copy the name while listed
+        taskENTER_CRITICAL();
+        job_t job = jobs[i];
+        if (job.state != JOB_FREE) {
+            strncpy(name, job.args->tokens[0], sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+        }
+        taskEXIT_CRITICAL();
+        if (job.state == JOB_FREE) {
+            continue;
+        }
+        const char *state = job.killed ? "killing" : job.state == JOB_RUNNING ? "running" : "queued";
+        snprintf(s, sizeof(s), "[%u] %-8s %s", job.id, state, name);
+        terminal_println(s);
+    }
+}
+
+/** `wait` command handler function. */
+static void wait_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count <= 2, usage);
+    if (args->count == 2) {
+        unsigned id = atoi(args->tokens[1]);
+        taskENTER_CRITICAL();
+        job_t *job = find_job(id);
+        taskEXIT_CRITICAL();
+        cli_assert(job != NULL, usage);
+        wait_job(job, id);
+        return;
+    }
+    for (int i = 0; i < JOB_MAX; i++) {
+        taskENTER_CRITICAL();
+        bool active = jobs[i].state != JOB_FREE;
+        unsigned id = jobs[i].id;
+        taskEXIT_CRITICAL();
+        if (active && !wait_job(&jobs[i], id)) {
+            return;
+        }
+    }
+}
+
+/** `kill` command handler function. */
+static void kill_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count == 2, usage);
+    unsigned id = atoi(args->tokens[1]);
+
+    // running commands stop cooperatively (see jobs_killed); aborting their blocking
+    // calls would make them fail with spurious errors. Looked up in the same critical
+    // section, so that a new job that took the slot is not killed instead.
+    taskENTER_CRITICAL();
+    job_t *job = find_job(id);
+    if (job != NULL) {
+        job->killed = true;
+    }
+    taskEXIT_CRITICAL();
+    cli_assert(job != NULL, usage);
+}
+
+const cmd_t jobs_command = {
+    .name = "jobs",
+    .description = "List background jobs (started with `&`)",
+    .handler = jobs_cmd_handler,
+};
+
+const cmd_t wait_command = {
+    .name = "wait",
+    .description = "Wait for background jobs",
+    .handler = wait_cmd_handler,
+};
+
+const cmd_t kill_command = {
+    .name = "kill",
+    .description = "Stop a background job",
+    .handler = kill_cmd_handler,
+};
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <string.h>
+#include "log.h"
+#include "terminal.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Amount of records in the ring buffer. Must be a power of 2. */
+#define LOG_RECORDS 256
+/** Amount of records copied at a time by `log dump` */
+#define LOG_DUMP_CHUNK 8
+
+/** Print the `log` command usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage: log <command>\r\n"
+        "\r\n"
+        "Commands:\r\n"
+        "\r\n"
+        "  dump\r\n"
+        "      Print `LOG <nrecords> <record_size> <nmessages> <cpu_hz> <dropped>` followed by\r\n"
+        "      the records in binary format, and remove them from the buffer. Decode them\r\n"
+        "      with tools/logdecode.py. Not allowed in background tasks (`loop`, `watch`,\r\n"
+        "      `irq`, `&`) unless redirected to a buffer.\r\n"
+        "\r\n"
+        "  stat\r\n"
+        "      Show the usage of the buffer and the amount of records dropped because it\r\n"
+        "      was full.\r\n"
+        "\r\n"
+        "  clear\r\n"
+        "      Discard all the records. Not allowed while a dump is in progress.\r\n"
+    );
+}
+
+/** Record ring buffer. */
+static log_record_t records[LOG_RECORDS];
+/** Total amount of records written; the next one goes to `head % LOG_RECORDS`. */
+static uint32_t head;
+/** Total amount of records read or discarded. */
+static uint32_t tail;
+/** Sequence number of the next record, counting the dropped ones. */
+static uint16_t sequence;
+/** Records dropped since the last dump because the buffer was full. */
+static uint32_t dropped;
+/** Total records dropped. */
+static uint32_t dropped_total;
+/** Whether a `log dump` is in progress; it owns `tail` until it finishes. */
+static bool dumping;
+
+/** Claim `tail` for a dump. \return false if another dump is in progress. */
+static bool begin_dump() {
+    taskENTER_CRITICAL();
+    bool busy = dumping;
+    dumping = true;
+    taskEXIT_CRITICAL();
+    return !busy;
+}
+
+void log_record(log_message_t message, uint32_t a0, uint32_t a1, uint32_t a2, uint32_t a3) {
+    uint32_t cycles = cyclesCounterRead();
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    uint16_t seq = sequence++;
+    if (head - tail < LOG_RECORDS) {
+        log_record_t *r = &records[head++ & (LOG_RECORDS - 1)];
+        r->cycles = cycles;
+        r->message = message;
+        r->sequence = seq;
+        r->args[0] = a0;
+        r->args[1] = a1;
+        r->args[2] = a2;
+        r->args[3] = a3;
+    } else {
+        dropped++;
+        dropped_total++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+/** `log dump` command handler. */
+static void log_dump() {
+    // a concurrent dump or clear would move tail past head
+    if (!begin_dump()) {
+        log_error("The log is already being dumped");
+        return;
+    }
+    // background output would corrupt the binary records
+    if (!terminal_begin_binary()) {
+        dumping = false;
+        return;
+    }
+
+    // only the records present now; the ones recorded meanwhile go in the next dump
+    taskENTER_CRITICAL();
+    uint32_t remaining = head - tail;
+    uint32_t lost = dropped;
+    dropped = 0;
+    taskEXIT_CRITICAL();
+
+    char s[64];
+    snprintf(s, sizeof(s), "LOG %lu %u %u %lu %lu", (unsigned long)remaining, (unsigned)sizeof(log_record_t),
+        (unsigned)LOG_MESSAGE_COUNT, (unsigned long)SystemCoreClock, (unsigned long)lost);
+    terminal_println(s);
+
+    log_record_t chunk[LOG_DUMP_CHUNK];
+    while (remaining > 0) {
+        uint32_t n = remaining < LOG_DUMP_CHUNK ? remaining : LOG_DUMP_CHUNK;
+        taskENTER_CRITICAL();
+        for (uint32_t i = 0; i < n; i++) {
+            chunk[i] = records[tail++ & (LOG_RECORDS - 1)];
+        }
+        taskEXIT_CRITICAL();
+        terminal_write(chunk, n * sizeof(log_record_t));
+        remaining -= n;
+    }
+    terminal_end_binary();
+    dumping = false;
+}
+
+/** `log clear` command handler. */
+static void log_clear() {
+    if (!begin_dump()) {
+        log_error("Cannot clear the log while it is being dumped");
+        return;
+    }
+    taskENTER_CRITICAL();
+    tail = head;
+    dropped = 0;
+    taskEXIT_CRITICAL();
+    dumping = false;
+}
+
+/** Print a counter value with its description. */
+static void print_counter(const char *name, uint32_t value) {
+    char s[48];
+    snprintf(s, sizeof(s), "%s: %lu", name, (unsigned long)value);
+    terminal_println(s);
+}
+
+/** `log stat` command handler. */
+static void log_stat() {
+    taskENTER_CRITICAL();
+    uint32_t used = head - tail;
+    uint32_t recorded = head;
+    uint32_t lost = dropped_total;
+    taskEXIT_CRITICAL();
+
+    char s[48];
+    snprintf(s, sizeof(s), "Buffered: %lu/%u records", (unsigned long)used, LOG_RECORDS);
+    terminal_println(s);
+    print_counter("Recorded", recorded);
+    print_counter("Dropped", lost);
+}
+
+/** `log` command handler function. */
+static void log_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count == 2, usage);
+    if (!strcmp(args->tokens[1], "dump")) {
+        log_dump();
+    } else if (!strcmp(args->tokens[1], "stat")) {
+        log_stat();
+    } else if (!strcmp(args->tokens[1], "clear")) {
+        log_clear();
+    } else {
+        cli_assert(false, usage);
+    }
+}
+
+const cmd_t log_command = {
+    .name = "log",
+    .description = "Dump the deferred binary log",
+    .handler = log_cmd_handler,
+};
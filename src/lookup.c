@@ -0,0 +1,62 @@
+#include <stdbool.h>
+#include <string.h>
+#include "lookup.h"
+
+/**
+ * Return the name of element i of a table of elements of the given size or, if indirect,
+ * of a table of pointers to the elements.
+ */
+static const char *name_at(const void *table, size_t i, size_t size, bool indirect) {
+    const void *element = (const char *)table + i * size;
+    if (indirect) {
+        element = *(const void *const *)element;
+    }
+    return *(const char *const *)element;
+}
+
+/** Binary search by name. \return the index of the element, or count if not found. */
+static size_t search(const char *name, const void *table, size_t count, size_t size, bool indirect) {
+    size_t lo = 0;
+    size_t hi = count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(name, name_at(table, mid, size, indirect));
+        if (cmp == 0) {
+            return mid;
+        }
+        if (cmp < 0) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return count;
+}
+
+/** Return true if the names are strictly increasing. */
+static bool sorted(const void *table, size_t count, size_t size, bool indirect) {
+    for (size_t i = 1; i < count; i++) {
+        if (strcmp(name_at(table, i - 1, size, indirect), name_at(table, i, size, indirect)) >= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const void *lookup_name(const char *name, const void *table, size_t count, size_t size) {
+    size_t i = search(name, table, count, size, false);
+    return i < count ? (const char *)table + i * size : NULL;
+}
+
+const void *lookup_name_indirect(const char *name, const void *const table[], size_t count) {
+    size_t i = search(name, table, count, sizeof(table[0]), true);
+    return i < count ? table[i] : NULL;
+}
+
+bool lookup_sorted(const void *table, size_t count, size_t size) {
+    return sorted(table, count, size, false);
+}
+
+bool lookup_sorted_indirect(const void *const table[], size_t count) {
+    return sorted(table, count, sizeof(table[0]), true);
+}
@@ -6,6 +6,9 @@
 #include "FreeRTOS.h"
 #include "task.h"
 
+/** Period at which a loop task checks whether it was stopped (ms) */
+#define LOOP_STOP_POLL_MS 50
+
 void loop_usage() {
     terminal_puts(
         "Usage:\r\n"
@@ -27,12 +30,18 @@ typedef struct {
     uint8_t loop_handle;
     /** Loop period in ms. */
     unsigned period;
-    /** RTOS task handle. */
+    /** RTOS task handle. NULL once the task has exited. */
     TaskHandle_t task_handle;
+    /** Set by `loop stop`; the task exits before the next execution of the command. */
+    volatile bool stopping;
     /** RTOS task name. */
-    TaskHandle_t task_name;
+    const char *task_name;
     /** Command to execute in the loop. */
     cmd_args_t subcmd;
+    /** Output sink inherited from the task that started the loop. */
+    terminal_sink_t *sink;
+    /** Rate limiter for the output of the loop task. */
+    terminal_limiter_t limiter;
 } loop_task_param_t;
 
 static loop_task_param_t settings[LOOP_TASKS] = {
@@ -53,14 +62,34 @@ bool find_free_loop_slot(uint8_t *loop_handle) {
     return false;
 }
 
+/**
+ * Wait until the next period, checking every LOOP_STOP_POLL_MS whether the task was stopped.
+ *
+ * \return false if the task was stopped.
+ */
+static bool wait_period(loop_task_param_t *s, TickType_t *last_wake) {
+    TickType_t remaining = pdMS_TO_TICKS(s->period);
+    while (remaining > 0 && !s->stopping) {
+        TickType_t slice = remaining < pdMS_TO_TICKS(LOOP_STOP_POLL_MS) ? remaining : pdMS_TO_TICKS(LOOP_STOP_POLL_MS);
+        vTaskDelayUntil(last_wake, slice);
+        remaining -= slice;
+    }
+    return !s->stopping;
+}
+
 /** RTOS task for a spawned loop. */
 static void loop_task(void *param) {
-    uint8_t loop_handle = ((loop_task_param_t *)param)->loop_handle;
+    loop_task_param_t *s = param;
+    terminal_set_sink(s->sink);
+    terminal_set_background(&s->limiter);
     TickType_t xLastWakeTime = xTaskGetTickCount();
-    while (true) {
-        vTaskDelayUntil(&xLastWakeTime, pdMS_TO_TICKS(settings[loop_handle].period));
-        cli_exec_command(&settings[loop_handle].subcmd);
+    while (wait_period(s, &xLastWakeTime)) {
+        cli_exec_command(&s->subcmd);
     }
+
+    // the command has returned its buffers; only now can the slot be reused
+    s->task_handle = NULL;
+    vTaskDelete(NULL);
 }
 
 /** `loop stop <handle>` command handler. */
@@ -73,12 +102,13 @@ static void loop_stop_cmd_handler(const cmd_args_t *args) {
         return;
     }
 
-    vTaskDelete(settings[loop_handle].task_handle);
-    settings[loop_handle].task_handle = NULL;
+    // killing the task in the middle of the command would leak the buffers it holds
+    settings[loop_handle].stopping = true;
 }
 
 /** `loop start <period> <command>` command handler. */
 static void loop_start_cmd_handler(const cmd_args_t *args) {
+    terminal_sink_t *sink = cli_take_redirection();
     int period = atoi(args->tokens[2]);
     cli_assert(period > 0, loop_usage);
 
@@ -89,6 +119,8 @@ static void loop_start_cmd_handler(const cmd_args_t *args) {
     }
 
     settings[loop_handle].period = period;
+    settings[loop_handle].sink = sink;
+    settings[loop_handle].stopping = false;
     cli_extract_subcommand(args, 3, &settings[loop_handle].subcmd);
 
     if (xTaskCreate(
@@ -100,6 +132,7 @@ static void loop_start_cmd_handler(const cmd_args_t *args) {
         &settings[loop_handle].task_handle
     ) != pdPASS) {
         log_error("Failed to create task");
+        return;
     }
 
     terminal_puts("Loop handle: ");
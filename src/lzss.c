@@ -0,0 +1,121 @@
+#include <string.h>
+#include "lzss.h"
+
+void lzss_init(lzss_encoder_t *encoder, lzss_output_t output, void *context) {
+    encoder->pos = 0;
+    encoder->end = 0;
+    encoder->bits = 0;
+    encoder->nbits = 0;
+    encoder->nout = 0;
+    encoder->output = output;
+    encoder->context = context;
+}
+
+/** Pass the compressed bytes in out to the output function. */
+static void flush_output(lzss_encoder_t *encoder) {
+    if (encoder->nout > 0) {
+        encoder->output(encoder->context, encoder->out, encoder->nout);
+        encoder->nout = 0;
+    }
+}
+
+/** Append the lowest n bits of value (n <= 24) to the output. */
+static void put_bits(lzss_encoder_t *encoder, uint32_t value, unsigned n) {
+    encoder->bits = (encoder->bits << n) | (value & ((1UL << n) - 1));
+    encoder->nbits += n;
+    while (encoder->nbits >= 8) {
+        encoder->nbits -= 8;
+        encoder->out[encoder->nout++] = encoder->bits >> encoder->nbits;
+        if (encoder->nout == LZSS_OUTPUT_CHUNK) {
+            flush_output(encoder);
+        }
+    }
+}
+
+/**
+ * Find the longest match for the bytes at pos, up to max_length bytes long.
+ *
+ * \return the match length (0 if none), and its distance in *distance.
+ */
+static size_t find_match(const lzss_encoder_t *encoder, size_t max_length, size_t *distance) {
+    const uint8_t *current = &encoder->window[encoder->pos];
+    size_t max_distance = encoder->pos < LZSS_WINDOW ? encoder->pos : LZSS_WINDOW;
+    size_t best = 0;
+    // nearest first, so that ties keep the shortest distance
+    for (size_t d = 1; d <= max_distance; d++) {
+        const uint8_t *candidate = current - d;
+        // a longer match must also differ from the best one at its last byte
+        if (candidate[best] != current[best] || candidate[0] != current[0]) {
+            continue;
+        }
+        size_t length = 1;
+        while (length < max_length && candidate[length] == current[length]) {
+            length++;
+        }
+        if (length > best) {
+            best = length;
+            *distance = d;
+            if (best == max_length) {
+                break;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * Encode the pending input. Unless finishing, stop while a full match could still extend
+ * past the available input.
+ */
+static void encode(lzss_encoder_t *encoder, bool finish) {
+    while (encoder->pos < encoder->end) {
+        size_t available = encoder->end - encoder->pos;
+        if (!finish && available < LZSS_MATCH_MAX) {
+            return;
+        }
+        size_t distance;
+        size_t length = find_match(encoder, available < LZSS_MATCH_MAX ? available : LZSS_MATCH_MAX, &distance);
+        if (length >= LZSS_MATCH_MIN) {
+            put_bits(encoder, 0, 1);
+            put_bits(encoder, distance - 1, LZSS_WINDOW_BITS);
+            put_bits(encoder, length - LZSS_MATCH_MIN, LZSS_LENGTH_BITS);
+            encoder->pos += length;
+        } else {
+            put_bits(encoder, 0x100 | encoder->window[encoder->pos], 9);
+            encoder->pos++;
+        }
+    }
+}
+
+void lzss_feed(lzss_encoder_t *encoder, const void *data, size_t nbytes) {
+    const uint8_t *p = data;
+    while (nbytes > 0) {
+        if (encoder->end == sizeof(encoder->window)) {
+            // keep a full window before pos (pos > LZSS_WINDOW, since encode() stopped
+            // less than LZSS_MATCH_MAX bytes before the end)
+            size_t shift = encoder->pos - LZSS_WINDOW;
+            memmove(encoder->window, &encoder->window[shift], encoder->end - shift);
+            encoder->pos -= shift;
+            encoder->end -= shift;
+        }
+        size_t n = sizeof(encoder->window) - encoder->end;
+        if (n > nbytes) {
+            n = nbytes;
+        }
+        memcpy(&encoder->window[encoder->end], p, n);
+        encoder->end += n;
+        p += n;
+        nbytes -= n;
+        encode(encoder, false);
+    }
+}
+
+void lzss_finish(lzss_encoder_t *encoder) {
+    encode(encoder, true);
+    if (encoder->nbits > 0) {
+        put_bits(encoder, 0, 8 - encoder->nbits);
+    }
+    flush_output(encoder);
+    encoder->pos = 0;
+    encoder->end = 0;
+}
@@ -3,10 +3,13 @@
 #include "sapi.h"
 #include "terminal.h"
 #include "cli.h"
+#include "jobs.h"
+#include "buf.h"
 
 int main(void)
 {
     boardInit();
+    cyclesCounterInit(SystemCoreClock);
 
     if (!terminal_init()) {
         return 1;
@@ -16,6 +19,14 @@ int main(void)
         return 1;
     }
 
+    if (!jobs_init()) {
+        return 1;
+    }
+
+    if (!buf_init()) {
+        return 1;
+    }
+
     vTaskStartScheduler();
 
     return 0;
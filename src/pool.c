@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <string.h>
+#include "pool.h"
+#include "log.h"
+#include "terminal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Pools that have been used at least once, for the `pool` command. */
+static pool_t *pools;
+
+/** Build the free list and register the pool. Must be called inside a critical section. */
+static void pool_init(pool_t *pool) {
+    uint8_t *block = pool->storage;
+    pool->free_list = NULL;
+    for (uint32_t i = 0; i < pool->stats.blocks; i++) {
+        pool_block_t *b = (pool_block_t *)(block + (pool->stats.blocks - 1 - i) * pool->block_size);
+        b->next = pool->free_list;
+        pool->free_list = b;
+    }
+    pool->next = pools;
+    pools = pool;
+    pool->initialized = true;
+}
+
+void *pool_alloc(pool_t *pool) {
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    if (!pool->initialized) {
+        pool_init(pool);
+    }
+    pool_block_t *block = pool->free_list;
+    if (block == NULL) {
+        pool->stats.exhausted++;
+    } else {
+        pool->free_list = block->next;
+        pool->stats.allocs++;
+        pool->stats.free--;
+        if (pool->stats.free < pool->stats.free_min) {
+            pool->stats.free_min = pool->stats.free;
+        }
+    }
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+    if (block == NULL) {
+        LOG(LOG_POOL_EXHAUSTED, pool->block_size);
+    }
+    return block;
+}
+
+void pool_free(pool_t *pool, void *block) {
+    if (block == NULL) {
+        return;
+    }
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    pool_block_t *b = block;
+    b->next = pool->free_list;
+    pool->free_list = b;
+    pool->stats.free++;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+}
+
+pool_stats_t pool_stats(const pool_t *pool) {
+    UBaseType_t saved = taskENTER_CRITICAL_FROM_ISR();
+    pool_stats_t stats = pool->stats;
+    taskEXIT_CRITICAL_FROM_ISR(saved);
+    return stats;
+}
+
+/** Print usage of the `pool` command. */
+static void pool_usage() {
+    terminal_puts(
+        "Usage:\r\n"
+        "  pool\r\n"
+        "      Show the size of each buffer pool, the amount of free blocks, the lowest\r\n"
+        "      amount of free blocks seen, and how many allocations failed. Then show the\r\n"
+        "      size of the RTOS heap, its free bytes and the lowest free bytes seen.\r\n"
+    );
+}
+
+/** `pool` command handler function. */
+static void pool_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count == 1, pool_usage);
+
+    terminal_println("name          size blocks free min-free allocs exhausted");
+    char s[80];
+    for (pool_t *pool = pools; pool; pool = pool->next) {
+        pool_stats_t stats = pool_stats(pool);
+        snprintf(s, sizeof(s), "%-12s %5lu %6lu %4lu %8lu %6lu %9lu",
+            pool->name,
+            (unsigned long)pool->block_size,
+            (unsigned long)stats.blocks,
+            (unsigned long)stats.free,
+            (unsigned long)stats.free_min,
+            (unsigned long)stats.allocs,
+            (unsigned long)stats.exhausted
+        );
+        terminal_println(s);
+    }
+
+    // tasks, queues and mutexes come from the RTOS heap instead
+    snprintf(s, sizeof(s), "RTOS heap: %lu bytes, %lu free, %lu min-free",
+        (unsigned long)configTOTAL_HEAP_SIZE,
+        (unsigned long)xPortGetFreeHeapSize(),
+        (unsigned long)xPortGetMinimumEverFreeHeapSize()
+    );
+    terminal_println(s);
+}
+
+const cmd_t pool_command = {
+    .name = "pool",
+    .description = "Show buffer pool statistics",
+    .handler = pool_cmd_handler,
+};
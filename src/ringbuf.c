@@ -0,0 +1,46 @@
+#include <string.h>
+#include "ringbuf.h"
+
+void ringbuf_init(ringbuf_t *rb, uint8_t *buf, size_t size) {
+    rb->buf = buf;
+    rb->size = size;
+    rb->head = 0;
+    rb->tail = 0;
+}
+
+size_t ringbuf_used(const ringbuf_t *rb) {
+    return rb->head - rb->tail;
+}
+
+size_t ringbuf_free(const ringbuf_t *rb) {
+    return rb->size - ringbuf_used(rb);
+}
+
+bool ringbuf_put(ringbuf_t *rb, const void *data, size_t nbytes) {
+    if (nbytes > ringbuf_free(rb)) {
+        return false;
+    }
+    size_t offset = rb->head & (rb->size - 1);
+    size_t first = rb->size - offset < nbytes ? rb->size - offset : nbytes;
+    memcpy(&rb->buf[offset], data, first);
+    memcpy(rb->buf, (const uint8_t *)data + first, nbytes - first);
+    rb->head += nbytes;
+    return true;
+}
+
+size_t ringbuf_get(ringbuf_t *rb, void *data, size_t nbytes) {
+    size_t used = ringbuf_used(rb);
+    if (nbytes > used) {
+        nbytes = used;
+    }
+    size_t offset = rb->tail & (rb->size - 1);
+    size_t first = rb->size - offset < nbytes ? rb->size - offset : nbytes;
+    memcpy(data, &rb->buf[offset], first);
+    memcpy((uint8_t *)data + first, rb->buf, nbytes - first);
+    rb->tail += nbytes;
+    return nbytes;
+}
+
+void ringbuf_clear(ringbuf_t *rb) {
+    rb->tail = rb->head;
+}
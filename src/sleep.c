@@ -1,8 +1,12 @@
 #include "sleep.h"
+#include "jobs.h"
 #include "terminal.h"
 #include "FreeRTOS.h"
 #include "task.h"
 
+/** Period at which a sleep checks whether its job was killed (ms) */
+#define SLEEP_POLL_MS 50
+
 /** Print the `sleep` command usage help. */
 static void usage() {
     terminal_puts(
@@ -18,7 +22,13 @@ static void sleep_cmd_handler(const cmd_args_t *args) {
     int32_t ms = atoi(args->tokens[1]);
     cli_assert(ms >= 0, usage);
 
-    vTaskDelay(ms / portTICK_PERIOD_MS);
+    TickType_t ticks = ms / portTICK_PERIOD_MS;
+    TickType_t start = xTaskGetTickCount();
+    TickType_t elapsed;
+    while ((elapsed = xTaskGetTickCount() - start) < ticks && !jobs_killed()) {
+        TickType_t remaining = ticks - elapsed;
+        vTaskDelay(remaining < pdMS_TO_TICKS(SLEEP_POLL_MS) ? remaining : pdMS_TO_TICKS(SLEEP_POLL_MS));
+    }
 }
 
 const cmd_t sleep_command = {
@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "spi.h"
+#include "spi_engine.h"
+#include "gpio.h"
+#include "hex.h"
+#include "jobs.h"
+#include "pool.h"
+#include "terminal.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "semphr.h"
+
+/** Size of each data buffer (bytes) */
+#define SPI_DATA_MAX 1024
+/** Amount of data buffers, shared by all the tasks running `spi` */
+#define SPI_DATA_BUFFERS 2
+/** Maximum amount of steps in a batch */
+#define SPI_BATCH_MAX 8
+/** Maximum time to wait for a transfer to complete (ms) */
+#define SPI_TIMEOUT_MS 1000
+/** Byte transmitted by `spi read` if none is given */
+#define SPI_FILL_DEFAULT 0xff
+
+// https://gcc.gnu.org/onlinedocs/cpp/Stringizing.html#Stringizing
+#define str(a) #a
+#define xstr(a) str(a)
+
+/** Print the `spi` command usage help. */
+static void usage() {
+    terminal_puts(
+        "Usage: spi <command> ...\r\n"
+        "\r\n"
+        "Commands:\r\n"
+        "\r\n"
+        "  help\r\n"
+        "\r\n"
+        "  init <freq> <mode> [cs <pin>]\r\n"
+        "      Configure the bus clock (Hz) and SPI mode (0-3). The actual clock is the\r\n"
+        "      closest one not above <freq>.\r\n"
+        "      Eg: spi init 10000000 0 cs GPIO0\r\n"
+        "\r\n"
+        "  cs <pin>|none|release\r\n"
+        "      Select the GPIO used as chip select (active low), asserted around each\r\n"
+        "      command; or release it after a command that used `hold`.\r\n"
+        "\r\n"
+        "  xfer <tx_data...> [hold]\r\n"
+        "      Full-duplex transfer: send the data and print the bytes received meanwhile.\r\n"
+        "      `hold` keeps the chip select asserted after the transfer.\r\n"
+        "      Eg: spi xfer 9f:00:00:00\r\n"
+        "\r\n"
+        "  read <nbytes> [<fill>] [hold]\r\n"
+        "      Receive <nbytes> (up to " xstr(SPI_DATA_MAX) ") while sending <fill> (default ff), and\r\n"
+        "      print them.\r\n"
+        "      Eg: spi read 256\r\n"
+        "\r\n"
+        "  batch tx|rx|xfer <arg> [...]\r\n"
+        "      Run several transfers with the chip select asserted throughout: `tx <tx_data>`\r\n"
+        "      discards the received bytes, `rx <nbytes>` and `xfer <tx_data>` print them.\r\n"
+        "      Eg: spi batch tx 03:00:10:00 rx 16\r\n"
+        "\r\n"
+        "  bench <nbytes> <count>\r\n"
+        "      Run <count> transfers of <nbytes> (up to " xstr(SPI_DATA_MAX) ") and report the throughput.\r\n"
+        "\r\n"
+        "  <tx_data...> can also be `-` or `@<nbytes>` (see `i2c help`), up to\r\n"
+        "  " xstr(SPI_DATA_MAX) " bytes in total.\r\n"
+    );
+}
+
+/** Mutex to synchronize concurrent access. */
+static SemaphoreHandle_t spi_mutex;
+
+/** Chip select pin. */
+static gpioMap_t cs_pin;
+/** True if a chip select pin was configured. */
+static bool cs_enabled;
+
+/** Buffers for the data of a command. */
+POOL_DEFINE(data_pool, "spi data", SPI_DATA_MAX, SPI_DATA_BUFFERS);
+
+/** A step of `spi batch`. */
+typedef struct {
+    /** Offset of the step data in the data buffer. */
+    size_t offset;
+    /** Amount of bytes to transfer. */
+    size_t nbytes;
+    /** True if the received data must be printed. */
+    bool print;
+} spi_step_t;
+
+/** Take the spi mutex. */
+static bool spi_take_mutex() {
+    if (xSemaphoreTake(spi_mutex, pdMS_TO_TICKS(100)) == pdFALSE) {
+        log_error("Failed to take mutex");
+        return false;
+    }
+    return true;
+}
+
+/** Release the spi mutex. */
+static bool spi_release_mutex() {
+    if (xSemaphoreGive(spi_mutex) == pdFALSE) {
+        log_error("Failed to release mutex");
+        return false;
+    }
+    return true;
+}
+
+/** Assert the chip select, if configured. */
+static void cs_assert() {
+    if (cs_enabled) {
+        gpioWrite(cs_pin, LOW);
+    }
+}
+
+/** Release the chip select, if configured. */
+static void cs_release() {
+    if (cs_enabled) {
+        gpioWrite(cs_pin, HIGH);
+    }
+}
+
+/** Configure the chip select pin, by name or `none`. \return false if the pin is unknown. */
+static bool set_cs(const char *name) {
+    if (!strcmp(name, "none")) {
+        cs_release();
+        cs_enabled = false;
+        return true;
+    }
+    gpioMap_t pin;
+    if (!gpio_find_pin(name, &pin)) {
+        return false;
+    }
+    cs_release();
+    cs_pin = pin;
+    cs_enabled = true;
+    gpioInit(cs_pin, GPIO_OUTPUT);
+    cs_release();
+    return true;
+}
+
+/** Print an error message for a failed transfer. */
+static void print_xfer_error(spi_xfer_status_t status) {
+    switch (status) {
+    case SPI_XFER_TIMEOUT:
+        log_error("spi transfer timed out");
+        break;
+    default:
+        log_error("spi DMA error");
+        break;
+    }
+}
+
+/**
+ * Run a list of in-place transfers on the data buffer with the chip select asserted
+ * throughout, in a single bus acquisition.
+ *
+ * \param hold Keep the chip select asserted at the end.
+ *
+ * \return false if the bus could not be acquired or a transfer failed.
+ */
+static bool spi_run(uint8_t data[], const spi_step_t steps[], unsigned count, bool hold) {
+    if (!spi_take_mutex()) {
+        return false;
+    }
+    cs_assert();
+    spi_xfer_status_t status = SPI_XFER_DONE;
+    for (unsigned i = 0; i < count && status == SPI_XFER_DONE; i++) {
+        uint8_t *p = data + steps[i].offset;
+        status = spi_engine_transfer(p, p, steps[i].nbytes, pdMS_TO_TICKS(SPI_TIMEOUT_MS));
+    }
+    if (!hold || status != SPI_XFER_DONE) {
+        cs_release();
+    }
+    spi_release_mutex();
+
+    if (status != SPI_XFER_DONE) {
+        print_xfer_error(status);
+        return false;
+    }
+    return true;
+}
+
+/** Check that `spi init` was called. */
+static bool check_init() {
+    if (!spi_engine_freq()) {
+        log_error("`spi init` must be called first.");
+        return false;
+    }
+    return true;
+}
+
+/** `spi init <freq> <mode> [cs <pin>]` command handler. */
+static void spi_init(const cmd_args_t *args) {
+    cli_assert(args->count == 4 || (args->count == 6 && !strcmp(args->tokens[4], "cs")), usage);
+    int32_t freq = atoi(args->tokens[2]);
+    int mode = atoi(args->tokens[3]);
+    cli_assert(freq > 0 && mode >= 0 && mode <= 3, usage);
+
+    if (spi_mutex == NULL) {
+        spi_mutex = xSemaphoreCreateMutex();
+        if (spi_mutex == NULL) {
+            log_error("Failed to create mutex");
+            return;
+        }
+    }
+    if (!spi_take_mutex()) {
+        return;
+    }
+    bool ok = spi_engine_init(freq, mode);
+    bool cs_ok = args->count == 4 || set_cs(args->tokens[5]);
+    spi_release_mutex();
+
+    if (!ok) {
+        log_error("Failed to initialize spi interface");
+        return;
+    }
+    cli_assert(cs_ok, usage);
+
+    char s[40];
+    snprintf(s, sizeof(s), "Clock: %lu Hz", (unsigned long)spi_engine_freq());
+    terminal_println(s);
+}
+
+/** `spi cs <pin>|none|release` command handler. */
+static void spi_cs(const cmd_args_t *args) {
+    cli_assert(args->count == 3, usage);
+    if (!check_init() || !spi_take_mutex()) {
+        return;
+    }
+    bool ok = true;
+    if (!strcmp(args->tokens[2], "release")) {
+        cs_release();
+    } else {
+        ok = set_cs(args->tokens[2]);
+    }
+    spi_release_mutex();
+    cli_assert(ok, usage);
+}
+
+/** Parse and execute `spi xfer ...`, using the given data buffer. */
+static void spi_xfer_exec(const cmd_args_t *args, uint8_t data[]) {
+    cli_assert(args->count == 3 || (args->count == 4 && !strcmp(args->tokens[3], "hold")), usage);
+
+    spi_step_t step = {.offset = 0, .print = true};
+    cli_assert(hex_read_data(args->tokens[2], &step.nbytes, data, SPI_DATA_MAX), usage);
+    if (spi_run(data, &step, 1, args->count == 4)) {
+        hex_print(data, step.nbytes);
+    }
+}
+
+/** Parse and execute `spi read ...`, using the given data buffer. */
+static void spi_read_exec(const cmd_args_t *args, uint8_t data[]) {
+    cli_assert(args->count >= 3 && args->count <= 5, usage);
+    int nbytes = atoi(args->tokens[2]);
+    cli_assert(nbytes > 0 && nbytes <= SPI_DATA_MAX, usage);
+
+    uint8_t fill = SPI_FILL_DEFAULT;
+    bool hold = false;
+    for (int i = 3; i < args->count; i++) {
+        if (!strcmp(args->tokens[i], "hold")) {
+            hold = true;
+        } else {
+            size_t n;
+            cli_assert(hex_data_nbytes(args->tokens[i], &n) && n == 1, usage);
+            cli_assert(hex_parse_data(args->tokens[i], 1, &fill), usage);
+        }
+    }
+
+    memset(data, fill, nbytes);
+    spi_step_t step = {.offset = 0, .nbytes = nbytes, .print = true};
+    if (spi_run(data, &step, 1, hold)) {
+        hex_print(data, nbytes);
+    }
+}
+
+/** Parse and execute `spi batch ...`, using the given data buffer. */
+static void spi_batch_exec(const cmd_args_t *args, uint8_t data[]) {
+    cli_assert(args->count >= 4 && args->count % 2 == 0, usage);
+
+    spi_step_t steps[SPI_BATCH_MAX];
+    unsigned count = 0;
+    size_t used = 0;
+    for (int i = 2; i < args->count; i += 2) {
+        cli_assert(count < SPI_BATCH_MAX, usage);
+        const char *kind = args->tokens[i];
+        const char *arg = args->tokens[i + 1];
+        spi_step_t *step = &steps[count++];
+        step->offset = used;
+        if (!strcmp(kind, "rx")) {
+            int nbytes = atoi(arg);
+            cli_assert(nbytes > 0 && nbytes <= SPI_DATA_MAX - used, usage);
+            step->nbytes = nbytes;
+            step->print = true;
+            memset(data + used, SPI_FILL_DEFAULT, nbytes);
+        } else {
+            cli_assert(!strcmp(kind, "tx") || !strcmp(kind, "xfer"), usage);
+            cli_assert(hex_read_data(arg, &step->nbytes, data + used, SPI_DATA_MAX - used), usage);
+            step->print = !strcmp(kind, "xfer");
+        }
+        used += step->nbytes;
+    }
+
+    if (!spi_run(data, steps, count, false)) {
+        return;
+    }
+    for (unsigned i = 0; i < count; i++) {
+        if (steps[i].print) {
+            hex_print(data + steps[i].offset, steps[i].nbytes);
+        }
+    }
+}
+
+/** Parse and execute `spi bench ...`, using the given data buffer. */
+static void spi_bench_exec(const cmd_args_t *args, uint8_t data[]) {
+    cli_assert(args->count == 4, usage);
+    int nbytes = atoi(args->tokens[2]);
+    int count = atoi(args->tokens[3]);
+    cli_assert(nbytes > 0 && nbytes <= SPI_DATA_MAX && count > 0, usage);
+
+    for (int i = 0; i < nbytes; i++) {
+        data[i] = i;
+    }
+
+    if (!spi_take_mutex()) {
+        return;
+    }
+    // each transfer is timed separately, since the cycle counter overflows every ~20 s
+    uint64_t total_cycles = 0;
+    spi_xfer_status_t status = SPI_XFER_DONE;
+    bool killed = false;
+    for (int i = 0; i < count && status == SPI_XFER_DONE; i++) {
+        if (jobs_killed()) {
+            killed = true;
+            break;
+        }
+        cs_assert();
+        uint32_t start = cyclesCounterRead();
+        status = spi_engine_transfer(data, data, nbytes, pdMS_TO_TICKS(SPI_TIMEOUT_MS));
+        total_cycles += cyclesCounterRead() - start;
+        cs_release();
+    }
+    spi_release_mutex();
+
+    if (killed) {
+        return;
+    }
+    if (status != SPI_XFER_DONE) {
+        print_xfer_error(status);
+        return;
+    }
+
+    uint64_t total_bytes = (uint64_t)nbytes * count;
+    uint64_t us = total_cycles / (SystemCoreClock / 1000000);
+    uint64_t bytes_per_s = us ? total_bytes * 1000000 / us : 0;
+    // throughput relative to the raw bit rate of the bus
+    uint64_t efficiency = bytes_per_s * 8 * 100 / spi_engine_freq();
+
+    char s[64];
+    snprintf(s, sizeof(s), "Bytes: %lu in %lu us", (unsigned long)total_bytes, (unsigned long)us);
+    terminal_println(s);
+    snprintf(s, sizeof(s), "Throughput: %lu bytes/s (%lu%% of %lu Hz)",
+        (unsigned long)bytes_per_s, (unsigned long)efficiency, (unsigned long)spi_engine_freq());
+    terminal_println(s);
+}
+
+/** Handler for the subcommands that need a data buffer. */
+typedef void (*spi_exec_t)(const cmd_args_t *args, uint8_t data[]);
+
+/** Run a subcommand handler with a data buffer taken from the pool. */
+static void spi_with_buffer(const cmd_args_t *args, spi_exec_t exec) {
+    if (!check_init()) {
+        return;
+    }
+    uint8_t *data = pool_alloc(&data_pool);
+    if (data == NULL) {
+        log_error("Out of spi buffers; see `pool`");
+        return;
+    }
+    exec(args, data);
+    pool_free(&data_pool, data);
+}
+
+/** `spi` command handler function. */
+static void spi_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count >= 2, usage);
+    if (!strcmp(args->tokens[1], "help")) {
+        usage();
+    } else if (!strcmp(args->tokens[1], "init")) {
+        spi_init(args);
+    } else if (!strcmp(args->tokens[1], "cs")) {
+        spi_cs(args);
+    } else if (!strcmp(args->tokens[1], "xfer")) {
+        spi_with_buffer(args, spi_xfer_exec);
+    } else if (!strcmp(args->tokens[1], "read")) {
+        spi_with_buffer(args, spi_read_exec);
+    } else if (!strcmp(args->tokens[1], "batch")) {
+        spi_with_buffer(args, spi_batch_exec);
+    } else if (!strcmp(args->tokens[1], "bench")) {
+        spi_with_buffer(args, spi_bench_exec);
+    } else {
+        cli_assert(false, usage);
+    }
+}
+
+const cmd_t spi_command = {
+    .name = "spi",
+    .description = "Control the SPI interface",
+    .handler = spi_cmd_handler,
+};
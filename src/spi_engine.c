@@ -0,0 +1,147 @@
+#include "spi_engine.h"
+#include "dma.h"
+#include "sapi.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** SSP peripheral driven by the engine. */
+#define SSP_REGS LPC_SSP1
+/** Clock of the SSP peripheral driven by the engine. */
+#define SSP_CLOCK CLK_MX_SSP1
+
+/** DMA channel that feeds the transmit FIFO, or -1 if not reserved yet. */
+static int tx_channel = -1;
+/** DMA channel that drains the receive FIFO, or -1 if not reserved yet. */
+static int rx_channel = -1;
+
+/** Task waiting for the transfer in progress. */
+static TaskHandle_t waiting;
+
+/** Set by the DMA ISR if a channel reported an error. */
+static volatile bool dma_error;
+
+/** Configured clock frequency (Hz), or 0 if not initialized. */
+static uint32_t freq_hz;
+
+/**
+ * Receive channel completion callback. Called from the DMA ISR.
+ *
+ * The last byte is received after the last byte is sent, so the end of the receive
+ * transfer is the end of the whole transfer.
+ */
+static void rx_done(uint8_t channel, bool ok, void *context, BaseType_t *woken) {
+    if (!ok) {
+        dma_error = true;
+    }
+    vTaskNotifyGiveFromISR(waiting, woken);
+}
+
+/** Transmit channel completion callback. Called from the DMA ISR. */
+static void tx_done(uint8_t channel, bool ok, void *context, BaseType_t *woken) {
+    if (!ok) {
+        // the receive channel would never finish
+        dma_error = true;
+        vTaskNotifyGiveFromISR(waiting, woken);
+    }
+}
+
+uint32_t spi_engine_max_freq() {
+    // minimum prescaler (CPSR) is 2
+    return Chip_Clock_GetRate(SSP_CLOCK) / 2;
+}
+
+uint32_t spi_engine_freq() {
+    return freq_hz;
+}
+
+bool spi_engine_init(uint32_t freq, uint8_t mode) {
+    static const uint32_t clock_modes[] = {
+        SSP_CLOCK_MODE0,
+        SSP_CLOCK_MODE1,
+        SSP_CLOCK_MODE2,
+        SSP_CLOCK_MODE3,
+    };
+
+    if (freq == 0 || freq > spi_engine_max_freq() || mode >= sizeof(clock_modes) / sizeof(clock_modes[0])) {
+        return false;
+    }
+
+    if (tx_channel < 0) {
+        tx_channel = dma_channel_open(tx_done, NULL);
+    }
+    if (rx_channel < 0) {
+        rx_channel = dma_channel_open(rx_done, NULL);
+    }
+    if (tx_channel < 0 || rx_channel < 0) {
+        return false;
+    }
+
+    // pin and clock configuration
+    if (!spiInit(SPI0)) {
+        return false;
+    }
+
+    Chip_SSP_Disable(SSP_REGS);
+    Chip_SSP_SetFormat(SSP_REGS, SSP_BITS_8, SSP_FRAMEFORMAT_SPI, clock_modes[mode]);
+    Chip_SSP_SetMaster(SSP_REGS, true);
+    Chip_SSP_SetBitRate(SSP_REGS, freq);
+    Chip_SSP_DMA_Enable(SSP_REGS);
+    Chip_SSP_Enable(SSP_REGS);
+
+    // bit rate = PCLK / (CPSDVSR * (SCR + 1))
+    uint32_t scr = (SSP_REGS->CR0 >> 8) & 0xff;
+    freq_hz = Chip_Clock_GetRate(SSP_CLOCK) / (SSP_REGS->CPSR * (scr + 1));
+    return true;
+}
+
+/** Abort the transfer in progress. */
+static void abort_transfer() {
+    dma_stop(tx_channel);
+    dma_stop(rx_channel);
+    while (Chip_SSP_GetStatus(SSP_REGS, SSP_STAT_BSY)) {
+    }
+    Chip_SSP_Int_FlushData(SSP_REGS);
+}
+
+spi_xfer_status_t spi_engine_transfer(const uint8_t *tx_data, uint8_t *rx_data, size_t nbytes, TickType_t timeout) {
+    if (!freq_hz) {
+        return SPI_XFER_ERROR;
+    }
+
+    waiting = xTaskGetCurrentTaskHandle();
+    TickType_t start = xTaskGetTickCount();
+
+    // a DMA transfer moves up to DMA_TRANSFER_MAX bytes
+    while (nbytes > 0) {
+        size_t chunk = nbytes > DMA_TRANSFER_MAX ? DMA_TRANSFER_MAX : nbytes;
+
+        // discard stale notifications and data
+        ulTaskNotifyTake(pdTRUE, 0);
+        dma_error = false;
+        Chip_SSP_Int_FlushData(SSP_REGS);
+
+        // the receive channel is started first, so that no byte is lost
+        if (
+            !dma_start(rx_channel, GPDMA_CONN_SSP1_Rx, (uint32_t)rx_data, GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA, chunk)
+            || !dma_start(tx_channel, (uint32_t)tx_data, GPDMA_CONN_SSP1_Tx, GPDMA_TRANSFERTYPE_M2P_CONTROLLER_DMA, chunk)
+        ) {
+            abort_transfer();
+            return SPI_XFER_ERROR;
+        }
+
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout || !ulTaskNotifyTake(pdTRUE, timeout - elapsed)) {
+            abort_transfer();
+            return SPI_XFER_TIMEOUT;
+        }
+        if (dma_error) {
+            abort_transfer();
+            return SPI_XFER_ERROR;
+        }
+
+        tx_data += chunk;
+        rx_data += chunk;
+        nbytes -= chunk;
+    }
+    return SPI_XFER_DONE;
+}
@@ -1,4 +1,7 @@
+#include <stdio.h>
+#include <string.h>
 #include "terminal.h"
+#include "log.h"
 #include "sapi.h"
 #include "FreeRTOS.h"
 #include "task.h"
@@ -9,11 +12,42 @@
 
 #define RXQUEUE_CAPACITY 128
 #define TXQUEUE_CAPACITY 128
+#define BGQUEUE_CAPACITY 256
+
+/** Default rate limit for the output of each background task (bytes/s). */
+#define BG_RATE_DEFAULT 2000
+/** Default burst size for the output of each background task (bytes). */
+#define BG_BURST_DEFAULT 512
+/** Maximum time that interactive output waits for the rest of a background line (ms). */
+#define BG_LINE_TIMEOUT_MS 10
+
+/** Thread local storage slot holding the output sink of each task. */
+#define TLS_SINK 0
+/** Thread local storage slot holding the output limiter of each background task. */
+#define TLS_LIMITER 1
 
 /** Input character buffer. */
 static QueueHandle_t rxQueue;
-/** Output character buffer. */
+/** Output character buffer for interactive output. */
 static QueueHandle_t txQueue;
+/** Output character buffer for background output, sent only when txQueue is empty. */
+static QueueHandle_t bgQueue;
+/** RTOS task handle for terminal_tx_task. */
+static TaskHandle_t tx_task_handle;
+
+/** Rate limit for the output of each background task (bytes/s), or 0 for unlimited. */
+static uint32_t bg_rate = BG_RATE_DEFAULT;
+/** Burst size for the output of each background task (bytes). */
+static uint32_t bg_burst = BG_BURST_DEFAULT;
+
+/** Output statistics. */
+static terminal_stats_t stats;
+
+/** While nonzero, terminal_tx_task holds the background output (see terminal_begin_binary). */
+static volatile uint32_t bg_holds;
+
+/** Interactive writes in progress; no background line is started meanwhile. */
+static volatile uint32_t interactive_writes;
 
 /**
  * ISR executed when a character is received on the UART, which is enqueued on rxQueue.
@@ -29,32 +63,265 @@ static void uart_rx_isr(void *unused)
 }
 
 /**
- * RTOS task that waits until there is a character waiting in txQueue and writes
- * it to the UART, in an infinite loop.
+ * RTOS task that writes the characters waiting in txQueue and bgQueue to the UART, in an
+ * infinite loop. Writers notify the task after enqueuing each character.
+ *
+ * The queues are switched only between lines: a background line is started only when
+ * txQueue is empty and no interactive write is in progress, and then it is sent whole
+ * (unless the rest of it takes more than BG_LINE_TIMEOUT_MS to arrive).
  */
 static void terminal_tx_task(void *param) {
+    bool bg_line = false;
+    TickType_t bg_last = 0;
     while (1) {
         char c;
-        if (xQueueReceive(txQueue, &c, portMAX_DELAY)) {
+        if (bg_holds) {
+            bg_line = false;
+        }
+        if (!bg_line && xQueueReceive(txQueue, &c, 0)) {
             uartWriteByte(UART_PORT, c);
+            continue;
+        }
+        if (!bg_holds && (bg_line || !interactive_writes) && xQueueReceive(bgQueue, &c, 0)) {
+            uartWriteByte(UART_PORT, c);
+            bg_line = c != '\n';
+            bg_last = xTaskGetTickCount();
+            continue;
+        }
+        if (!bg_line) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        TickType_t waited = xTaskGetTickCount() - bg_last;
+        if (waited >= pdMS_TO_TICKS(BG_LINE_TIMEOUT_MS)) {
+            // the rest of the line is late (eg: dropped by the rate limit)
+            bg_line = false;
+            continue;
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(BG_LINE_TIMEOUT_MS) - waited);
+    }
+}
+
+/** Enqueue a character for terminal_tx_task. \return false if the queue is full. */
+static bool enqueue(QueueHandle_t queue, char c, TickType_t timeout) {
+    if (!xQueueSendToBack(queue, &c, timeout)) {
+        return false;
+    }
+    if (tx_task_handle) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+    return true;
+}
+
+/** Add to a counter of the output statistics. */
+static void count(uint32_t *counter, size_t nbytes) {
+    taskENTER_CRITICAL();
+    *counter += nbytes;
+    taskEXIT_CRITICAL();
+}
+
+/** Take nbytes tokens from the bucket of a background task. \return false if there are not enough. */
+static bool limiter_take(terminal_limiter_t *limiter, size_t nbytes) {
+    if (bg_rate == 0) {
+        return true;
+    }
+    TickType_t now = xTaskGetTickCount();
+    TickType_t elapsed = now - limiter->last_refill;
+    uint64_t earned = (uint64_t)elapsed * bg_rate / configTICK_RATE_HZ;
+    uint64_t tokens = limiter->tokens + earned;
+    if (tokens >= bg_burst) {
+        limiter->tokens = bg_burst;
+        limiter->last_refill = now;
+    } else {
+        // advance only by the ticks converted into tokens, keeping the remainder for the
+        // next call; otherwise slow rates would round down to nothing on every write
+        limiter->tokens = tokens;
+        limiter->last_refill += (earned * configTICK_RATE_HZ + bg_rate - 1) / bg_rate;
+    }
+
+    if (nbytes > limiter->tokens) {
+        return false;
+    }
+    limiter->tokens -= nbytes;
+    return true;
+}
+
+/** Return the output limiter of the calling task, or NULL if its output is interactive. */
+static terminal_limiter_t *get_limiter();
+
+/**
+ * Mark the start of a write that must not be split by a background line, if the calling
+ * task writes interactive output to the UART.
+ *
+ * \return true if marked; then interactive_end must be called.
+ */
+static bool interactive_begin() {
+    if (terminal_get_sink() || get_limiter()) {
+        return false;
+    }
+    taskENTER_CRITICAL();
+    interactive_writes++;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+/** Mark the end of an interactive write. */
+static void interactive_end() {
+    taskENTER_CRITICAL();
+    interactive_writes--;
+    taskEXIT_CRITICAL();
+    if (tx_task_handle) {
+        xTaskNotifyGive(tx_task_handle);
+    }
+}
+
+/**
+ * Format the summary of the output dropped since the last output of a background task.
+ * Written by hand: snprintf would take too much of the small stack of a loop task.
+ *
+ * \return the length of the note.
+ */
+static size_t format_dropped_note(char note[], uint32_t dropped) {
+    static const char suffix[] = " bytes of output dropped]\r\n";
+    char digits[10];
+    size_t ndigits = 0;
+    do {
+        digits[ndigits++] = '0' + dropped % 10;
+        dropped /= 10;
+    } while (dropped > 0);
+
+    size_t n = 0;
+    note[n++] = '[';
+    while (ndigits > 0) {
+        note[n++] = digits[--ndigits];
+    }
+    memcpy(&note[n], suffix, sizeof(suffix) - 1);
+    return n + sizeof(suffix) - 1;
+}
+
+/** Write background output, dropping whatever exceeds the rate limit or does not fit in bgQueue. */
+static void write_background(terminal_limiter_t *limiter, const char *s, size_t nbytes) {
+    if (!limiter_take(limiter, nbytes)) {
+        limiter->dropped += nbytes;
+        count(&stats.dropped, nbytes);
+        LOG(LOG_TERMINAL_DROPPED, nbytes);
+        return;
+    }
+
+    if (limiter->dropped > 0) {
+        // summarize what was dropped since the last output of the task
+        char note[40];
+        size_t note_nbytes = format_dropped_note(note, limiter->dropped);
+        size_t i = 0;
+        while (i < note_nbytes && enqueue(bgQueue, note[i], 0)) {
+            i++;
         }
+        // a note cut by a full queue is output dropped as well, reported by the next one
+        limiter->dropped = note_nbytes - i;
+        if (i < note_nbytes) {
+            count(&stats.dropped, note_nbytes - i);
+            LOG(LOG_TERMINAL_DROPPED, note_nbytes - i);
+        }
+    }
+
+    for (size_t i = 0; i < nbytes; i++) {
+        if (!enqueue(bgQueue, s[i], 0)) {
+            limiter->dropped += nbytes - i;
+            count(&stats.dropped, nbytes - i);
+            LOG(LOG_TERMINAL_DROPPED, nbytes - i);
+            nbytes = i;
+            break;
+        }
+    }
+    count(&stats.background, nbytes);
+}
+
+bool terminal_begin_binary() {
+    if (!terminal_get_sink() && get_limiter()) {
+        log_error("Binary output from a background task must be redirected to a buffer");
+        return false;
+    }
+    taskENTER_CRITICAL();
+    bg_holds++;
+    taskEXIT_CRITICAL();
+    return true;
+}
+
+void terminal_end_binary() {
+    taskENTER_CRITICAL();
+    bg_holds--;
+    taskEXIT_CRITICAL();
+    if (tx_task_handle) {
+        xTaskNotifyGive(tx_task_handle);
     }
 }
 
+terminal_sink_t *terminal_get_sink() {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return NULL;
+    }
+    return pvTaskGetThreadLocalStoragePointer(NULL, TLS_SINK);
+}
+
+terminal_sink_t *terminal_set_sink(terminal_sink_t *sink) {
+    terminal_sink_t *previous = terminal_get_sink();
+    vTaskSetThreadLocalStoragePointer(NULL, TLS_SINK, sink);
+    return previous;
+}
+
+void terminal_set_background(terminal_limiter_t *limiter) {
+    if (limiter) {
+        limiter->tokens = bg_burst;
+        limiter->last_refill = xTaskGetTickCount();
+        limiter->dropped = 0;
+    }
+    vTaskSetThreadLocalStoragePointer(NULL, TLS_LIMITER, limiter);
+}
+
+static terminal_limiter_t *get_limiter() {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return NULL;
+    }
+    return pvTaskGetThreadLocalStoragePointer(NULL, TLS_LIMITER);
+}
+
+void terminal_write(const void *data, size_t nbytes) {
+    terminal_sink_t *sink = terminal_get_sink();
+    if (sink) {
+        sink->write(sink, data, nbytes);
+        return;
+    }
+    const char *s = data;
+    terminal_limiter_t *limiter = get_limiter();
+    if (limiter) {
+        write_background(limiter, s, nbytes);
+        return;
+    }
+    interactive_begin();
+    for (size_t i = 0; i < nbytes; i++) {
+        enqueue(txQueue, s[i], portMAX_DELAY);
+    }
+    interactive_end();
+    count(&stats.interactive, nbytes);
+}
+
 void terminal_putc(const char c) {
-    xQueueSendToBack(txQueue, &c, portMAX_DELAY);
+    terminal_write(&c, 1);
 }
 
 void terminal_puts(const char s[]) {
-    for (; *s; s++) {
-        terminal_putc(*s);
-    }
+    terminal_write(s, strlen(s));
 }
 
 void terminal_println(const char s[]) {
+    // the line and its end as a single write
+    bool interactive = interactive_begin();
     terminal_puts(s);
     terminal_putc('\r');
     terminal_putc('\n');
+    if (interactive) {
+        interactive_end();
+    }
 }
 
 char terminal_getc() {
@@ -78,6 +345,16 @@ void terminal_gets(char buf[], size_t bufsize) {
     *s = '\0';
 }
 
+size_t terminal_read(void *data, size_t nbytes, unsigned timeout_ms) {
+    char *s = data;
+    for (size_t i = 0; i < nbytes; i++) {
+        if (!xQueueReceive(rxQueue, &s[i], pdMS_TO_TICKS(timeout_ms))) {
+            return i;
+        }
+    }
+    return nbytes;
+}
+
 bool terminal_init() {
     rxQueue = xQueueCreate(RXQUEUE_CAPACITY, sizeof(char));
     if (rxQueue == NULL) {
@@ -91,6 +368,12 @@ bool terminal_init() {
         return false;
     }
 
+    bgQueue = xQueueCreate(BGQUEUE_CAPACITY, sizeof(char));
+    if (bgQueue == NULL) {
+        log_error("Failed to create bgQueue");
+        return false;
+    }
+
     uartConfig(UART_PORT, 115200);
     uartCallbackSet(UART_PORT, UART_RECEIVE, uart_rx_isr, NULL);
     uartInterrupt(UART_PORT, true);
@@ -101,7 +384,7 @@ bool terminal_init() {
         configMINIMAL_STACK_SIZE,
         0,
         TERMINAL_TASK_PRIORITY,
-        0
+        &tx_task_handle
     ) != pdPASS) {
         log_error("Failed to create task");
         return false;
@@ -109,3 +392,53 @@ bool terminal_init() {
 
     return true;
 }
+
+/** Print the `terminal` command usage help. */
+static void terminal_usage() {
+    terminal_puts(
+        "Usage:\r\n"
+        "  terminal stat\r\n"
+        "      Show the amount of interactive and background output, and the background\r\n"
+        "      output dropped by the rate limit.\r\n"
+        "  terminal limit <bytes_per_s> [<burst>]\r\n"
+        "      Limit the output of each background task (loop, watch, irq, &); 0 = unlimited.\r\n"
+        "Output of the command line has priority over background output.\r\n"
+    );
+}
+
+/** Print a named counter. */
+static void print_counter(const char *name, unsigned long n) {
+    char s[40];
+    snprintf(s, sizeof(s), "%s: %lu", name, n);
+    terminal_println(s);
+}
+
+/** `terminal` command handler function. */
+static void terminal_cmd_handler(const cmd_args_t *args) {
+    if (args->count == 2 && !strcmp(args->tokens[1], "stat")) {
+        taskENTER_CRITICAL();
+        terminal_stats_t snapshot = stats;
+        taskEXIT_CRITICAL();
+        print_counter("Interactive bytes", snapshot.interactive);
+        print_counter("Background bytes", snapshot.background);
+        print_counter("Background bytes dropped", snapshot.dropped);
+        print_counter("Background limit (bytes/s)", bg_rate);
+        print_counter("Background burst (bytes)", bg_burst);
+        return;
+    }
+    if ((args->count == 3 || args->count == 4) && !strcmp(args->tokens[1], "limit")) {
+        int rate = atoi(args->tokens[2]);
+        int burst = args->count == 4 ? atoi(args->tokens[3]) : BG_BURST_DEFAULT;
+        cli_assert(rate >= 0 && burst > 0, terminal_usage);
+        bg_rate = rate;
+        bg_burst = burst;
+        return;
+    }
+    cli_assert(false, terminal_usage);
+}
+
+const cmd_t terminal_command = {
+    .name = "terminal",
+    .description = "Show or limit terminal output",
+    .handler = terminal_cmd_handler,
+};
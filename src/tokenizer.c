@@ -0,0 +1,59 @@
+#include <string.h>
+#include "tokenizer.h"
+
+void tokenizer_init(tokenizer_t *tokenizer, cmd_args_t *args) {
+    tokenizer->args = args;
+    tokenizer->len = 0;
+    tokenizer->in_token = false;
+    tokenizer->error = TOKENIZER_MORE;
+    args->count = 0;
+}
+
+/** Store a character in the line buffer, keeping room for the final null character. */
+static bool store(tokenizer_t *tokenizer, char c) {
+    if (tokenizer->len >= CLI_LINE_MAX - 1) {
+        tokenizer->error = TOKENIZER_TOO_LONG;
+        return false;
+    }
+    tokenizer->args->buf[tokenizer->len++] = c;
+    return true;
+}
+
+tokenizer_status_t tokenizer_feed(tokenizer_t *tokenizer, char c) {
+    cmd_args_t *args = tokenizer->args;
+
+    if (c == '\n') {
+        args->buf[tokenizer->len] = '\0';
+        return tokenizer->error == TOKENIZER_MORE ? TOKENIZER_LINE : tokenizer->error;
+    }
+    if (tokenizer->error != TOKENIZER_MORE) {
+        // discard the rest of the line
+        return TOKENIZER_MORE;
+    }
+
+    if (c == ' ' || c == '\t' || c == '\r') {
+        if (tokenizer->in_token && store(tokenizer, '\0')) {
+            tokenizer->in_token = false;
+        }
+        return TOKENIZER_MORE;
+    }
+
+    if (!tokenizer->in_token) {
+        if (args->count >= CLI_ARGC_MAX - 1) {
+            tokenizer->error = TOKENIZER_TOO_MANY_ARGS;
+            return TOKENIZER_MORE;
+        }
+        args->tokens[args->count++] = &args->buf[tokenizer->len];
+        tokenizer->in_token = true;
+    }
+    store(tokenizer, c);
+    return TOKENIZER_MORE;
+}
+
+void cli_extract_subcommand(const cmd_args_t *cmd, unsigned subcmd_arg_index, cmd_args_t *subcmd) {
+    memcpy(subcmd->buf, cmd->buf, CLI_LINE_MAX);
+    subcmd->count = cmd->count - subcmd_arg_index;
+    for (int i = 0; i < subcmd->count; i++) {
+        subcmd->tokens[i] = subcmd->buf + (cmd->tokens[subcmd_arg_index + i] - cmd->buf);
+    }
+}
@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <string.h>
+#include "watch.h"
+#include "task_priorities.h"
+#include "terminal.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/** Period at which a watch task checks whether it was stopped (ms) */
+#define WATCH_STOP_POLL_MS 50
+
+/** Amount of supported watch tasks */
+#define WATCH_TASKS 2
+/** Amount of output of each execution kept for printing (bytes) */
+#define WATCH_OUTPUT_MAX 256
+
+/** FNV-1a 32-bit offset basis. */
+#define FNV_OFFSET 2166136261UL
+/** FNV-1a 32-bit prime. */
+#define FNV_PRIME 16777619UL
+
+static void watch_usage() {
+    terminal_puts(
+        "Usage:\r\n"
+        "  watch <period_ms> [heartbeat <heartbeat_ms>] <command...>\r\n"
+        "      Execute the command every <period_ms>, and print its output (with a\r\n"
+        "      timestamp) only when it differs from the previous one. With `heartbeat`,\r\n"
+        "      print an `unchanged` line if nothing was printed for <heartbeat_ms>.\r\n"
+        "  watch stop <handle>\r\n"
+        "Example:\r\n"
+        "  $ watch 10 heartbeat 5000 gpio TEC1 read\r\n"
+        "  Watch handle: 0\r\n"
+        "  [1234 ms] watch 0:\r\n"
+        "  low\r\n"
+        "  $ watch stop 0\r\n"
+    );
+}
+
+/** Output sink that captures the output of each execution of the watched command. */
+typedef struct {
+    /** Output sink. Must be the first member. */
+    terminal_sink_t sink;
+    /** Hash of the whole output. */
+    uint32_t hash;
+    /** Total amount of output bytes. */
+    size_t nbytes;
+    /** First WATCH_OUTPUT_MAX bytes of the output. */
+    char output[WATCH_OUTPUT_MAX];
+} watch_capture_t;
+
+/** Parameters for the RTOS watch task. */
+typedef struct {
+    /** Index number in the settings array. */
+    uint8_t watch_handle;
+    /** Period in ms. */
+    unsigned period;
+    /** Heartbeat period in ms, or 0 for no heartbeat. */
+    unsigned heartbeat;
+    /** RTOS task handle. NULL once the task has exited. */
+    TaskHandle_t task_handle;
+    /** Set by `watch stop`; the task exits before the next execution of the command. */
+    volatile bool stopping;
+    /** RTOS task name. */
+    const char *task_name;
+    /** Command to execute. */
+    cmd_args_t subcmd;
+    /** Output sink inherited from the task that started the watch. */
+    terminal_sink_t *sink;
+    /** Rate limiter for the output of the watch task. */
+    terminal_limiter_t limiter;
+    /** Capture of the output of the last execution. */
+    watch_capture_t capture;
+} watch_task_param_t;
+
+static watch_task_param_t settings[WATCH_TASKS] = {
+    {.watch_handle = 0, .task_name = "watch0"},
+    {.watch_handle = 1, .task_name = "watch1"},
+};
+
+/** Capture sink write function: hash all the output and keep its beginning. */
+static void capture_write(terminal_sink_t *sink, const void *data, size_t nbytes) {
+    watch_capture_t *capture = (watch_capture_t *)sink;
+    const uint8_t *p = data;
+    for (size_t i = 0; i < nbytes; i++) {
+        capture->hash = (capture->hash ^ p[i]) * FNV_PRIME;
+        if (capture->nbytes < WATCH_OUTPUT_MAX) {
+            capture->output[capture->nbytes] = p[i];
+        }
+        capture->nbytes++;
+    }
+}
+
+/** Print the header of a watch output line. */
+static void print_header(const watch_task_param_t *s, const char *suffix) {
+    char str[40];
+    snprintf(str, sizeof(str), "[%lu ms] watch %u%s", (unsigned long)xTaskGetTickCount(), s->watch_handle, suffix);
+    terminal_println(str);
+}
+
+/**
+ * Wait until the next period, checking every WATCH_STOP_POLL_MS whether the task was stopped.
+ *
+ * \return false if the task was stopped.
+ */
+static bool wait_period(watch_task_param_t *s, TickType_t *last_wake) {
+    TickType_t remaining = pdMS_TO_TICKS(s->period);
+    while (remaining > 0 && !s->stopping) {
+        TickType_t slice = remaining < pdMS_TO_TICKS(WATCH_STOP_POLL_MS) ? remaining : pdMS_TO_TICKS(WATCH_STOP_POLL_MS);
+        vTaskDelayUntil(last_wake, slice);
+        remaining -= slice;
+    }
+    return !s->stopping;
+}
+
+/** RTOS task for a spawned watch. */
+static void watch_task(void *param) {
+    watch_task_param_t *s = param;
+    s->capture.sink.write = capture_write;
+    terminal_set_sink(s->sink);
+    terminal_set_background(&s->limiter);
+
+    bool first = true;
+    uint32_t last_hash = 0;
+    TickType_t last_print = xTaskGetTickCount();
+    TickType_t xLastWakeTime = xTaskGetTickCount();
+    do {
+        s->capture.hash = FNV_OFFSET;
+        s->capture.nbytes = 0;
+        terminal_set_sink(&s->capture.sink);
+        cli_exec_command(&s->subcmd);
+        terminal_set_sink(s->sink);
+
+        if (first || s->capture.hash != last_hash) {
+            print_header(s, ":");
+            size_t nbytes = s->capture.nbytes < WATCH_OUTPUT_MAX ? s->capture.nbytes : WATCH_OUTPUT_MAX;
+            terminal_write(s->capture.output, nbytes);
+            if (s->capture.nbytes > WATCH_OUTPUT_MAX) {
+                terminal_println("...");
+            }
+            first = false;
+            last_hash = s->capture.hash;
+            last_print = xTaskGetTickCount();
+        } else if (s->heartbeat && xTaskGetTickCount() - last_print >= pdMS_TO_TICKS(s->heartbeat)) {
+            print_header(s, " unchanged");
+            last_print = xTaskGetTickCount();
+        }
+    } while (wait_period(s, &xLastWakeTime));
+
+    // the command has returned its buffers; only now can the slot be reused
+    s->task_handle = NULL;
+    vTaskDelete(NULL);
+}
+
+/** Find a free slot for a new watch. */
+static bool find_free_watch_slot(uint8_t *watch_handle) {
+    for (int i = 0; i < WATCH_TASKS; i++) {
+        if (settings[i].task_handle == NULL) {
+            *watch_handle = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+/** `watch stop <handle>` command handler. */
+static void watch_stop_cmd_handler(const cmd_args_t *args) {
+    uint8_t watch_handle = atoi(args->tokens[2]);
+    cli_assert(watch_handle < WATCH_TASKS, watch_usage);
+
+    if (settings[watch_handle].task_handle == NULL) {
+        log_error("Watch task not started");
+        return;
+    }
+
+    // killing the task in the middle of the command would leak the buffers it holds
+    settings[watch_handle].stopping = true;
+}
+
+/** `watch <period> [heartbeat <ms>] <command>` command handler. */
+static void watch_start_cmd_handler(const cmd_args_t *args) {
+    terminal_sink_t *sink = cli_take_redirection();
+    int period = atoi(args->tokens[1]);
+    cli_assert(period > 0, watch_usage);
+
+    int heartbeat = 0;
+    unsigned subcmd_index = 2;
+    if (!strcmp(args->tokens[2], "heartbeat")) {
+        cli_assert(args->count >= 5, watch_usage);
+        heartbeat = atoi(args->tokens[3]);
+        cli_assert(heartbeat > 0, watch_usage);
+        subcmd_index = 4;
+    }
+
+    uint8_t watch_handle;
+    if (!find_free_watch_slot(&watch_handle)) {
+        log_error("Too many watches. Use `watch stop` to free a slot.");
+        return;
+    }
+
+    watch_task_param_t *s = &settings[watch_handle];
+    s->period = period;
+    s->heartbeat = heartbeat;
+    s->sink = sink;
+    s->stopping = false;
+    cli_extract_subcommand(args, subcmd_index, &s->subcmd);
+
+    if (xTaskCreate(
+        watch_task,
+        s->task_name,
+        configMINIMAL_STACK_SIZE * 2,
+        s,
+        LOOP_TASK_PRIORITY,
+        &s->task_handle
+    ) != pdPASS) {
+        log_error("Failed to create task");
+        return;
+    }
+
+    terminal_puts("Watch handle: ");
+    char str[4];
+    snprintf(str, sizeof(str), "%d", watch_handle);
+    terminal_println(str);
+}
+
+/** `watch` command handler function. */
+static void watch_cmd_handler(const cmd_args_t *args) {
+    cli_assert(args->count >= 3, watch_usage);
+    if (args->count == 3 && !strcmp(args->tokens[1], "stop")) {
+        watch_stop_cmd_handler(args);
+        return;
+    }
+    watch_start_cmd_handler(args);
+}
+
+const cmd_t watch_command = {
+    .name = "watch",
+    .description = "Execute a command periodically, printing only changes",
+    .handler = watch_cmd_handler,
+};
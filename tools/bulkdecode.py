@@ -0,0 +1,146 @@
+#!/usr/bin/env python3
+"""Decoder for the compressed output of the `bulk` command.
+
+Reads a capture of the UART (or a live stream on stdin), finds each `BULK <window_bits>
+<length_bits>` header, decompresses the frames that follow it and checks the size and
+CRC-32 of the result. The decompressed output is written to stdout (or to -o), so it can
+be piped to the decoders of the dumps themselves, eg: `bulk log dump` to
+tools/logdecode.py. Any other output between the transfers is ignored.
+
+Examples:
+
+    tools/bulkdecode.py capture.bin > buf0.txt
+    tools/bulkdecode.py capture.bin | tools/logdecode.py
+"""
+
+import argparse
+import re
+import struct
+import sys
+import zlib
+
+HEADER = re.compile(rb"BULK (\d+) (\d+)\r\n")
+# uncompressed size and CRC-32, after the last frame
+TRAILER = struct.Struct("<II")
+# must match lzss.h
+MATCH_MIN = 2
+
+
+class BitReader:
+    """Reads a bit stream, most significant bit first."""
+
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def remaining(self):
+        return len(self.data) * 8 - self.pos
+
+    def read(self, n):
+        value = 0
+        for _ in range(n):
+            byte = self.data[self.pos >> 3]
+            value = value << 1 | (byte >> (7 - (self.pos & 7)) & 1)
+            self.pos += 1
+        return value
+
+
+def decompress(data, window_bits, length_bits, size):
+    """Decode an LZSS bit stream (see lzss.h) into size bytes."""
+    out = bytearray()
+    bits = BitReader(data)
+    while len(out) < size:
+        # the padding at the end is shorter than any token
+        if bits.remaining() < 9:
+            raise ValueError("truncated stream")
+        if bits.read(1):
+            out.append(bits.read(8))
+            continue
+        if bits.remaining() < window_bits + length_bits:
+            raise ValueError("truncated stream")
+        distance = bits.read(window_bits) + 1
+        length = bits.read(length_bits) + MATCH_MIN
+        if distance > len(out):
+            raise ValueError(f"match distance {distance} before the start of the stream")
+        # the match may overlap the bytes it produces
+        for _ in range(length):
+            out.append(out[-distance])
+    return bytes(out[:size])
+
+
+def parse_transfer(data, start):
+    """Parse the frames and trailer from data[start:].
+
+    Return (compressed bytes, size, crc, end offset), or None if incomplete.
+    """
+    frames = []
+    i = start
+    while True:
+        if i >= len(data):
+            return None
+        n = data[i]
+        i += 1
+        if n == 0:
+            break
+        if i + n > len(data):
+            return None
+        frames.append(data[i:i + n])
+        i += n
+    if i + TRAILER.size > len(data):
+        return None
+    size, crc = TRAILER.unpack_from(data, i)
+    return b"".join(frames), size, crc, i + TRAILER.size
+
+
+def decode(stream, out):
+    """Find the transfers in a byte stream and decode them, as the data arrives."""
+    data = b""
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        data += chunk
+        while True:
+            m = HEADER.search(data)
+            if not m:
+                # keep a possible partial header
+                data = data[-32:]
+                break
+            transfer = parse_transfer(data, m.end())
+            if transfer is None:
+                data = data[m.start():]
+                break
+            compressed, size, crc, end = transfer
+            window_bits, length_bits = int(m.group(1)), int(m.group(2))
+            try:
+                result = decompress(compressed, window_bits, length_bits, size)
+            except ValueError as e:
+                print(f"error: {e}", file=sys.stderr)
+            else:
+                if zlib.crc32(result) != crc:
+                    print("error: CRC mismatch", file=sys.stderr)
+                else:
+                    ratio = size / (end - m.start())
+                    print(f"{size} bytes in {end - m.start()} ({ratio:.1f}x)", file=sys.stderr)
+                    out.write(result)
+                    out.flush()
+            data = data[end:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", nargs="?", help="capture of the UART output (default: stdin)")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    out = open(args.output, "wb") if args.output else sys.stdout.buffer
+    with out:
+        if args.input:
+            with open(args.input, "rb") as f:
+                decode(f, out)
+        else:
+            decode(sys.stdin.buffer, out)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,435 @@
+#!/usr/bin/env python3
+"""Load generator for the command line interface.
+
+Drives the CLI over a serial port or pseudo-terminal (or the simulator, through its
+stdin/stdout) like a host program would: it sends a weighted mix of commands from a
+corpus at a given rate and pipeline depth while background `loop`/`irq` tasks run, and
+parses the `$ ` prompts printed by `cli_task` to match each response with its command.
+
+Reports commands/second, response latency percentiles, responses that were wrong or
+garbled (eg: interleaved with background output), commands lost (eg: receive queue
+overflow) and the background output dropped by the terminal rate limiter.
+
+Examples:
+
+    tools/loadgen.py /dev/ttyUSB1 --rate 50 --depth 2 --duration 30
+    SIM_GPIO_SCRIPT=tools/loadgen.gpio tools/loadgen.py --sim sim/build/cmd-uart-rtos-sim \\
+        --depth 4 --count 2000 --json results.json
+"""
+
+import argparse
+import json
+import os
+import random
+import re
+import select
+import subprocess
+import sys
+import termios
+import time
+
+PROMPT = b"$ "
+EOL = b"\r\n"
+DROPPED_NOTE = re.compile(rb"\[(\d+) bytes of output dropped\]")
+ERROR_PREFIXES = (b"Error:", b"Unknown command:", b"Unknown output buffer:")
+
+BAUD_RATES = {
+    9600: termios.B9600,
+    19200: termios.B19200,
+    38400: termios.B38400,
+    57600: termios.B57600,
+    115200: termios.B115200,
+    230400: termios.B230400,
+    460800: getattr(termios, "B460800", None),
+    921600: getattr(termios, "B921600", None),
+}
+
+
+class Corpus:
+    """Commands, background output patterns and setup/teardown commands, read from a file.
+
+    Line format (see tools/loadgen_corpus.txt):
+
+        setup: <command>
+        teardown: <command>
+        background: <regex>
+        <weight> <command> [=> <regex>]
+    """
+
+    def __init__(self, path):
+        self.setup = []
+        self.teardown = []
+        self.background = [DROPPED_NOTE]
+        self.commands = []
+        self.weights = []
+        with open(path) as f:
+            for n, line in enumerate(f, 1):
+                line = line.strip()
+                if not line or line.startswith("#"):
+                    continue
+                key, _, value = line.partition(":")
+                if key in ("setup", "teardown", "background") and value:
+                    value = value.strip()
+                    if key == "background":
+                        self.background.append(re.compile(value.encode()))
+                    else:
+                        getattr(self, key).append(value)
+                    continue
+                weight, _, rest = line.partition(" ")
+                command, _, expected = rest.partition("=>")
+                try:
+                    self.weights.append(float(weight))
+                except ValueError:
+                    sys.exit(f"{path}:{n}: invalid line")
+                self.commands.append((command.strip(), expected.strip() or None))
+        if not self.commands:
+            sys.exit(f"{path}: no commands")
+
+    def pick(self, rng, seq):
+        """
+        Return a random command, the regex its response must match (None: empty) and
+        whether the response is unique to this command.
+        """
+        command, expected = rng.choices(self.commands, self.weights)[0]
+        anchor = expected is not None and "{seq}" in expected
+        command = command.replace("{seq}", str(seq))
+        if expected is not None:
+            expected = re.compile(expected.replace("{seq}", str(seq)).encode())
+        return command, expected, anchor
+
+    def is_background(self, line):
+        return any(p.fullmatch(line) for p in self.background)
+
+
+class SerialTransport:
+    """A serial port or pseudo-terminal, in raw mode."""
+
+    def __init__(self, path, baud):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY | os.O_NONBLOCK)
+        attrs = termios.tcgetattr(self.fd)
+        attrs[0] = 0                                    # iflag
+        attrs[1] = 0                                    # oflag
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[3] = 0                                    # lflag
+        speed = BAUD_RATES.get(baud)
+        if speed is None:
+            sys.exit(f"unsupported baud rate: {baud}")
+        attrs[4] = attrs[5] = speed
+        termios.tcsetattr(self.fd, termios.TCSANOW, attrs)
+        termios.tcflush(self.fd, termios.TCIOFLUSH)
+        self.rfd = self.wfd = self.fd
+
+    def close(self):
+        os.close(self.fd)
+
+
+class ProcessTransport:
+    """The simulator, talking through its stdin and stdout."""
+
+    def __init__(self, command):
+        self.proc = subprocess.Popen(command, stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+        self.rfd = self.proc.stdout.fileno()
+        self.wfd = self.proc.stdin.fileno()
+        os.set_blocking(self.rfd, False)
+
+    def close(self):
+        self.proc.stdin.close()
+        try:
+            self.proc.wait(timeout=5)
+        except subprocess.TimeoutExpired:
+            self.proc.kill()
+
+
+class Pending:
+    """A command sent and not answered yet."""
+
+    def __init__(self, seq, command, expected, sent, anchor=False):
+        self.seq = seq
+        self.command = command
+        self.expected = expected
+        self.sent = sent
+        # true if the response is unique to this command (it contains `{seq}`)
+        self.anchor = anchor
+
+
+class Session:
+    """Splits the received stream into background lines and per-command responses."""
+
+    def __init__(self, transport, corpus, verbose):
+        self.t = transport
+        self.corpus = corpus
+        self.verbose = verbose
+        self.rx = b""
+        self.lines = []
+        self.pending = []
+        self.stats = {
+            "sent": 0, "ok": 0, "wrong": 0, "errors": 0, "garbled": 0, "lost": 0,
+            "resyncs": 0, "background_lines": 0, "background_dropped_bytes": 0,
+            "rx_bytes": 0, "tx_bytes": 0,
+        }
+        self.latencies = []
+        self.sync_marker = None
+        self.marker_seen = False
+        self.synced = False
+
+    def send(self, line):
+        data = line.encode() + b"\n"
+        while data:
+            select.select([], [self.t.wfd], [])
+            n = os.write(self.t.wfd, data)
+            data = data[n:]
+        self.stats["tx_bytes"] += len(line) + 1
+
+    def submit(self, seq, command, expected, anchor):
+        self.send(command)
+        self.pending.append(Pending(seq, command, expected, time.monotonic(), anchor))
+        self.stats["sent"] += 1
+
+    def poll(self, timeout):
+        """Wait up to timeout for input, and process it. Return False on end of input."""
+        r, _, _ = select.select([self.t.rfd], [], [], max(timeout, 0))
+        if not r:
+            return True
+        try:
+            data = os.read(self.t.rfd, 4096)
+        except BlockingIOError:
+            return True
+        if not data:
+            return False
+        now = time.monotonic()
+        self.stats["rx_bytes"] += len(data)
+        self.rx += data
+        self._process(now)
+        return True
+
+    def _process(self, now):
+        while True:
+            p = self.rx.find(PROMPT)
+            e = self.rx.find(EOL)
+            if e >= 0 and (p < 0 or e < p):
+                self._line(self.rx[:e])
+                self.rx = self.rx[e + len(EOL):]
+            elif p >= 0:
+                if p > 0:
+                    # output not terminated by a newline before the prompt
+                    self._line(self.rx[:p])
+                self.rx = self.rx[p + len(PROMPT):]
+                self._prompt(now)
+            else:
+                return
+
+    def _line(self, line):
+        m = DROPPED_NOTE.search(line)
+        if m:
+            # the rate limiter cuts background output anywhere, even within a line, and
+            # notes it before the next background output
+            self.stats["background_lines"] += 1
+            self.stats["background_dropped_bytes"] += int(m.group(1))
+            line = line[m.end():]
+        # lone carriage returns and empty lines are remains of truncated background lines
+        line = line.strip(b"\r")
+        if not line:
+            return
+        if self.corpus.is_background(line):
+            self.stats["background_lines"] += 1
+            return
+        if line == self.sync_marker:
+            self.marker_seen = True
+        self.lines.append(line)
+
+    def _prompt(self, now):
+        """A prompt ends the response of the oldest pending command."""
+        lines, self.lines = self.lines, []
+        if self.marker_seen:
+            self.marker_seen = False
+            self.synced = True
+        if not self.pending:
+            return
+        self._realign(lines)
+        cmd = self.pending.pop(0)
+        if cmd.seq < 0:
+            # setup and teardown commands are not part of the results
+            return
+        if self._matches(lines, cmd.expected):
+            kind = "ok"
+        elif any(line.startswith(ERROR_PREFIXES) for line in lines):
+            kind = "errors"
+        elif self._garbled(lines, cmd.expected):
+            kind = "garbled"
+        else:
+            kind = "wrong"
+        self.stats[kind] += 1
+        self.latencies.append(now - cmd.sent)
+        if kind != "ok" and self.verbose:
+            print(f"[{kind}] {cmd.command!r}: {lines!r}", file=sys.stderr)
+
+    def _realign(self, lines):
+        """
+        If the response belongs to a later command (eg: lost bytes merged two command lines,
+        so one prompt never came), count the commands before it as lost.
+        """
+        for i, cmd in enumerate(self.pending[1:], 1):
+            if cmd.anchor and any(cmd.expected.fullmatch(line) for line in lines):
+                self.stats["lost"] += sum(1 for lost in self.pending[:i] if lost.seq >= 0)
+                del self.pending[:i]
+                return
+
+    @staticmethod
+    def _matches(lines, expected):
+        if expected is None:
+            return not lines
+        return len(lines) == 1 and expected.fullmatch(lines[0]) is not None
+
+    def _garbled(self, lines, expected):
+        """
+        Return true if the expected response is there, but mixed with other output (eg:
+        background output interleaved within a line, or cut by the rate limiter).
+        """
+        if expected is None:
+            return True
+        if any(expected.fullmatch(line) for line in lines):
+            return True
+        text = b"".join(lines)
+        for p in self.corpus.background:
+            text = p.sub(b"", text)
+        return expected.fullmatch(text) is not None
+
+    def sync(self, marker, timeout):
+        """
+        Send `echo <marker>` and discard everything until the prompt that follows its
+        response, so that the next prompt belongs to the next command sent. Pending
+        commands are counted as lost.
+        """
+        self.stats["lost"] += sum(1 for cmd in self.pending if cmd.seq >= 0)
+        self.pending = []
+        deadline = time.monotonic() + timeout
+        attempt = 0
+        while time.monotonic() < deadline:
+            attempt += 1
+            # only the marker of the last attempt counts: the prompts of earlier attempts
+            # may still be on their way
+            self.sync_marker = f"{marker}.{attempt}".encode()
+            self.synced = False
+            # the newline ends any partial line left by a lost byte
+            self.send("")
+            self.send("echo " + self.sync_marker.decode())
+            retry = time.monotonic() + 1.0
+            while time.monotonic() < min(retry, deadline):
+                if not self.poll(0.05):
+                    return False
+                if self.synced:
+                    self.sync_marker = None
+                    return True
+        self.sync_marker = None
+        return False
+
+    def run_blocking(self, command, timeout):
+        """Send a setup or teardown command and wait for its prompt."""
+        self.send(command)
+        self.pending.append(Pending(-1, command, None, time.monotonic()))
+        deadline = time.monotonic() + timeout
+        while self.pending and time.monotonic() < deadline:
+            if not self.poll(deadline - time.monotonic()):
+                break
+        self.pending = []
+
+
+def percentile(values, p):
+    if not values:
+        return None
+    values = sorted(values)
+    k = min(len(values) - 1, max(0, round(p / 100 * (len(values) - 1))))
+    return values[k]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    target = parser.add_mutually_exclusive_group(required=True)
+    target.add_argument("port", nargs="?", help="serial port or pseudo-terminal")
+    target.add_argument("--sim", metavar="PATH", help="run the simulator and talk through its stdin/stdout")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--corpus", default=os.path.join(os.path.dirname(__file__), "loadgen_corpus.txt"))
+    parser.add_argument("--rate", type=float, default=0, help="commands per second (default: as fast as --depth allows)")
+    parser.add_argument("--depth", type=int, default=1, help="maximum commands sent without a response (default 1)")
+    stop = parser.add_mutually_exclusive_group()
+    stop.add_argument("--count", type=int, help="amount of commands to send")
+    stop.add_argument("--duration", type=float, help="seconds to run (default 10)")
+    parser.add_argument("--timeout", type=float, default=2.0, help="seconds to wait for a response before resyncing")
+    parser.add_argument("--seed", type=int, default=1, help="seed of the command mix, for repeatable runs")
+    parser.add_argument("--json", metavar="FILE", help="write the results to a JSON file")
+    parser.add_argument("-v", "--verbose", action="store_true", help="print the responses that are not ok")
+    args = parser.parse_args()
+    if args.count is None and args.duration is None:
+        args.duration = 10.0
+
+    corpus = Corpus(args.corpus)
+    transport = ProcessTransport([args.sim]) if args.sim else SerialTransport(args.port, args.baud)
+    session = Session(transport, corpus, args.verbose)
+    rng = random.Random(args.seed)
+
+    if not session.sync("~sync0", 10):
+        sys.exit("no response from the CLI")
+    for command in corpus.setup:
+        session.run_blocking(command, args.timeout)
+    session.stats.update(background_lines=0, background_dropped_bytes=0, rx_bytes=0, tx_bytes=0)
+
+    seq = 0
+    start = time.monotonic()
+    next_send = start
+    end = start + args.duration if args.duration else None
+    while True:
+        now = time.monotonic()
+        done_sending = (args.count is not None and seq >= args.count) or (end is not None and now >= end)
+        if done_sending and not session.pending:
+            break
+        if session.pending and now - session.pending[0].sent > args.timeout:
+            session.stats["resyncs"] += 1
+            if not session.sync(f"~sync{session.stats['resyncs']}", 10):
+                sys.exit("lost the CLI")
+            next_send = time.monotonic()
+            continue
+        if not done_sending and len(session.pending) < args.depth and now >= next_send:
+            seq += 1
+            session.submit(seq, *corpus.pick(rng, seq))
+            next_send = next_send + 1 / args.rate if args.rate else now
+            continue
+        wait = args.timeout
+        if not done_sending and len(session.pending) < args.depth:
+            wait = next_send - now
+        if not session.poll(min(wait, 0.05)):
+            sys.exit("the CLI closed the connection")
+    elapsed = time.monotonic() - start
+
+    for command in corpus.teardown:
+        session.run_blocking(command, args.timeout)
+    transport.close()
+
+    s = session.stats
+    completed = s["ok"] + s["wrong"] + s["errors"] + s["garbled"]
+    lat = session.latencies
+    results = {
+        "rate": args.rate, "depth": args.depth, "seed": args.seed, "corpus": args.corpus,
+        "elapsed_s": round(elapsed, 3),
+        "commands_per_s": round(completed / elapsed, 2) if elapsed else 0,
+        "latency_ms": {
+            name: round(percentile(lat, p) * 1000, 3) if lat else None
+            for name, p in (("p50", 50), ("p90", 90), ("p99", 99), ("max", 100))
+        },
+        **s,
+    }
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+            f.write("\n")
+
+    print(f"{s['sent']} commands in {elapsed:.2f} s: {results['commands_per_s']} commands/s")
+    print("latency (ms): " + "  ".join(f"{k} {v}" for k, v in results["latency_ms"].items()))
+    print(f"ok {s['ok']}  wrong {s['wrong']}  errors {s['errors']}  garbled {s['garbled']}  "
+          f"lost {s['lost']}  resyncs {s['resyncs']}")
+    print(f"background: {s['background_lines']} lines, {s['background_dropped_bytes']} bytes dropped")
+    failed = s["wrong"] + s["errors"] + s["garbled"] + s["lost"]
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
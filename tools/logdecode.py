@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+"""Decoder for the deferred binary log.
+
+Reads the output of `log dump` (a capture of the UART, or a live stream on stdin while
+`log dump` is sent periodically from the command line), finds each `LOG <nrecords>
+<record_size> <nmessages> <cpu_hz> <dropped>` header and formats the records that follow
+it with the message list in inc/log_messages.h. Any other output between the dumps is
+ignored.
+
+Examples:
+
+    tools/logdecode.py capture.bin
+    cat /dev/ttyUSB1 | tools/logdecode.py
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+DEFAULT_MESSAGES = os.path.join(os.path.dirname(__file__), "..", "inc", "log_messages.h")
+HEADER = re.compile(rb"LOG (\d+) (\d+) (\d+) (\d+) (\d+)\r\n")
+# cycles, message, sequence; followed by the arguments
+RECORD_PREFIX = struct.Struct("<IHH")
+CONVERSION = re.compile(r"%%|%\{([^}]*)\}|%([-+ #0]*\d*)([udxXc])")
+
+
+def load_messages(path):
+    """Return the list of (id, format) from the X-macro list in log_messages.h."""
+    with open(path) as f:
+        text = f.read()
+    messages = re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', text)
+    if not messages:
+        sys.exit(f"{path}: no messages found")
+    return [(name, fmt.encode().decode("unicode_escape")) for name, fmt in messages]
+
+
+def format_message(fmt, args):
+    """Format a message like the firmware would have printed it."""
+    args = iter(args)
+
+    def convert(m):
+        if m.group(0) == "%%":
+            return "%"
+        value = next(args, 0)
+        if m.group(1) is not None:
+            names = m.group(1).split(",")
+            return names[value] if value < len(names) else f"<{value}>"
+        flags, conversion = m.group(2), m.group(3)
+        if conversion == "d":
+            value = value - (1 << 32) if value & (1 << 31) else value
+        elif conversion == "u":
+            conversion = "d"
+        elif conversion == "c":
+            value = chr(value & 0xff)
+        return f"%{flags}{conversion}" % value
+
+    return CONVERSION.sub(convert, fmt)
+
+
+class Decoder:
+    """Formats records, keeping the state needed across dumps (time and sequence)."""
+
+    def __init__(self, messages, out):
+        self.messages = messages
+        self.out = out
+        self.cycles = None
+        self.time = 0
+        self.sequence = None
+
+    def dump(self, nmessages, hz, dropped, records, record_size):
+        if nmessages != len(self.messages):
+            print(f"warning: the firmware has {nmessages} messages, {len(self.messages)} known; "
+                  "is log_messages.h from the same build?", file=sys.stderr)
+        if dropped:
+            self.out.write(f"[{dropped} records dropped, buffer full]\n")
+        nargs = (record_size - RECORD_PREFIX.size) // 4
+        args_format = struct.Struct(f"<{nargs}I")
+        for i in range(0, len(records), record_size):
+            record = records[i:i + record_size]
+            cycles, message, sequence = RECORD_PREFIX.unpack_from(record)
+            args = args_format.unpack_from(record, RECORD_PREFIX.size)
+            self.record(hz, cycles, message, sequence, args)
+        self.out.flush()
+
+    def record(self, hz, cycles, message, sequence, args):
+        if self.sequence is not None:
+            gap = (sequence - self.sequence - 1) & 0xffff
+            if gap:
+                self.out.write(f"[{gap} records missing]\n")
+        self.sequence = sequence
+        # the 32-bit cycle counter wraps every few seconds: accumulate the differences
+        if self.cycles is not None:
+            self.time += ((cycles - self.cycles) & 0xffffffff) / hz
+        self.cycles = cycles
+
+        if message < len(self.messages):
+            text = format_message(self.messages[message][1], args)
+        else:
+            text = f"unknown message {message} {list(args)}"
+        self.out.write(f"[{self.time:12.6f}] {text}\n")
+
+
+def decode(stream, decoder):
+    """Find the dumps in a byte stream and decode them, as the data arrives."""
+    data = b""
+    while True:
+        chunk = stream.read1(4096) if hasattr(stream, "read1") else stream.read(4096)
+        if not chunk:
+            break
+        data += chunk
+        while True:
+            m = HEADER.search(data)
+            if not m:
+                # keep a possible partial header
+                data = data[-64:]
+                break
+            nrecords, record_size, nmessages, hz, dropped = map(int, m.groups())
+            end = m.end() + nrecords * record_size
+            if len(data) < end:
+                data = data[m.start():]
+                break
+            decoder.dump(nmessages, hz, dropped, data[m.end():end], record_size)
+            data = data[end:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("input", nargs="?", help="capture of the UART output (default: stdin)")
+    parser.add_argument("--messages", default=DEFAULT_MESSAGES, help="path of log_messages.h")
+    args = parser.parse_args()
+
+    decoder = Decoder(load_messages(args.messages), sys.stdout)
+    if args.input:
+        with open(args.input, "rb") as f:
+            decode(f, decoder)
+    else:
+        decode(sys.stdin.buffer, decoder)
+
+
+if __name__ == "__main__":
+    main()